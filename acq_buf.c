@@ -0,0 +1,168 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "acq_buf.h"
+
+void acq_buf_pool_init (acq_buf_pool_t *pool, int flags)
+{
+    memset (pool, 0, sizeof (*pool));
+    pool->flags = flags;
+}
+
+void acq_buf_pool_destroy (acq_buf_pool_t *pool)
+{
+    for (size_t i = 0; i < pool->num_bufs; i++) {
+        munmap (pool->bufs[i].data, pool->bufs[i].size);
+    }
+    free (pool->bufs);
+    acq_buf_pool_init (pool, 0);
+}
+
+static size_t _round_up (size_t size, size_t align)
+{
+    return (size + align - 1)/align*align;
+}
+
+/* Map size bytes aligned to align, so transparent huge pages can back the
+ * whole range */
+static void *_map_aligned (size_t size, size_t align)
+{
+    size_t map_size = size + align;
+    uint8_t *map = mmap (NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    uint8_t *data = (uint8_t *) _round_up ((uintptr_t) map, align);
+    if (data > map) {
+        munmap (map, data - map);
+    }
+    if (map + map_size > data + size) {
+        munmap (data + size, map + map_size - (data + size));
+    }
+    return data;
+}
+
+/* Returns the mapped size, 0 on failure */
+static size_t _map (int flags, size_t size, void **data)
+{
+    size_t page_size = (size_t) sysconf (_SC_PAGESIZE);
+
+    if (size < ACQ_BUF_HUGE_PAGE_SIZE) {
+        size = _round_up (size, page_size);
+        *data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE,
+                -1, 0);
+        return (*data == MAP_FAILED) ? 0 : size;
+    }
+
+    size = _round_up (size, ACQ_BUF_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+    if (flags & ACQ_BUF_HUGETLB) {
+        *data = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (*data != MAP_FAILED) {
+            return size;
+        }
+    }
+#else
+    (void) flags;
+#endif
+
+    *data = _map_aligned (size, ACQ_BUF_HUGE_PAGE_SIZE);
+    if (*data == NULL) {
+        return 0;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise (*data, size, MADV_HUGEPAGE);
+#endif
+    /* Fault the pages in now, after the advice, instead of in the capture */
+    for (size_t off = 0; off < size; off += page_size) {
+        ((volatile uint8_t *) *data)[off] = 0;
+    }
+    return size;
+}
+
+/* Lock or unlock buf as the flags of the pool ask. Returns 1 if it could
+ * not be locked */
+static int _lock (const acq_buf_pool_t *pool, acq_buf_t *buf)
+{
+    int lock = (pool->flags & ACQ_BUF_MLOCK) != 0;
+
+    if (lock && !buf->locked) {
+        if (mlock (buf->data, buf->size) != 0) {
+            return 1;
+        }
+        buf->locked = 1;
+    } else if (!lock && buf->locked) {
+        munlock (buf->data, buf->size);
+        buf->locked = 0;
+    }
+    return 0;
+}
+
+int acq_buf_get (acq_buf_pool_t *pool, size_t size, void **data)
+{
+    /* The smallest free buffer that fits, mapped for the same huge pages */
+    acq_buf_t *best = NULL;
+    for (size_t i = 0; i < pool->num_bufs; i++) {
+        acq_buf_t *buf = &pool->bufs[i];
+        if (!buf->in_use && buf->size >= size && !((buf->flags ^ pool->flags) & ACQ_BUF_HUGETLB) &&
+                (best == NULL || buf->size < best->size)) {
+            best = buf;
+        }
+    }
+    if (best != NULL) {
+        best->in_use = 1;
+        *data = best->data;
+        return _lock (pool, best);
+    }
+
+    /* None of the free buffers fits: drop them, so the pool does not keep
+     * more memory than it hands out */
+    for (size_t i = 0; i < pool->num_bufs; ) {
+        if (!pool->bufs[i].in_use) {
+            munmap (pool->bufs[i].data, pool->bufs[i].size);
+            pool->bufs[i] = pool->bufs[--pool->num_bufs];
+        } else {
+            i++;
+        }
+    }
+
+    if (pool->num_bufs == pool->cap) {
+        size_t cap = (pool->cap == 0) ? 8 : 2*pool->cap;
+        acq_buf_t *bufs = realloc (pool->bufs, cap*sizeof (*bufs));
+        if (bufs == NULL) {
+            return -1;
+        }
+        pool->bufs = bufs;
+        pool->cap = cap;
+    }
+
+    acq_buf_t *buf = &pool->bufs[pool->num_bufs];
+    buf->size = _map (pool->flags, (size != 0) ? size : 1, &buf->data);
+    if (buf->size == 0) {
+        return -1;
+    }
+    buf->flags = pool->flags;
+    buf->locked = 0;
+    buf->in_use = 1;
+    pool->num_bufs++;
+    *data = buf->data;
+
+    return _lock (pool, buf);
+}
+
+void acq_buf_put (acq_buf_pool_t *pool, void *data)
+{
+    if (data == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < pool->num_bufs; i++) {
+        if (pool->bufs[i].data == data) {
+            pool->bufs[i].in_use = 0;
+            return;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef _ACQ_BUF_H_
+#define _ACQ_BUF_H_
+
+#include <stddef.h>
+
+/* Acquisition buffers: anonymous mappings that are faulted in once, when
+ * they are created, and then recycled between captures, so the capture
+ * path neither zero fills nor page faults and the resident memory is the
+ * largest set of buffers in use at the same time. A pool is not thread
+ * safe: each session owns one */
+
+/* Back buffers of at least ACQ_BUF_HUGE_PAGE_SIZE with explicit huge pages
+ * (MAP_HUGETLB) when the system has them reserved. Transparent huge pages
+ * are always advised */
+#define ACQ_BUF_HUGETLB             (1 << 0)
+/* Lock the buffers in memory */
+#define ACQ_BUF_MLOCK               (1 << 1)
+
+#define ACQ_BUF_HUGE_PAGE_SIZE      (2*1024*1024)
+
+typedef struct {
+    void *data;
+    /* Mapped size */
+    size_t size;
+    /* ACQ_BUF_* flags of the pool when the buffer was mapped */
+    int flags;
+    int locked;
+    int in_use;
+} acq_buf_t;
+
+typedef struct {
+    /* ACQ_BUF_* flags of the buffers handed out from now on. A free buffer
+     * is only recycled if it was mapped with the same ACQ_BUF_HUGETLB, and
+     * it is locked or unlocked as ACQ_BUF_MLOCK asks */
+    int flags;
+    acq_buf_t *bufs;
+    size_t num_bufs;
+    size_t cap;
+} acq_buf_pool_t;
+
+void acq_buf_pool_init (acq_buf_pool_t *pool, int flags);
+
+/* Unmap every buffer of the pool, in use or not */
+void acq_buf_pool_destroy (acq_buf_pool_t *pool);
+
+/* Take a buffer of at least size bytes from the pool, mapping a new one if
+ * no free buffer fits. Its contents are undefined. Returns 0,
+ * 1 if the buffer could not be locked as ACQ_BUF_MLOCK asks, or -1 if it
+ * could not be mapped */
+int acq_buf_get (acq_buf_pool_t *pool, size_t size, void **data);
+
+/* Give a buffer back to the pool, for the next acq_buf_get */
+void acq_buf_put (acq_buf_pool_t *pool, void *data);
+
+#endif
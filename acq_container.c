@@ -0,0 +1,90 @@
+#include <string.h>
+#include "acq_container.h"
+
+#define ACQ_CONTAINER_NUM_LANES     4
+
+_Static_assert (sizeof (acq_container_hdr_t) == 128, "acq_container_hdr_t layout changed");
+
+static uint64_t _align (uint64_t value, uint64_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+void acq_container_hdr_init (acq_container_hdr_t *hdr, uint32_t chan, uint32_t sample_size,
+        uint32_t num_samples_pre, uint32_t num_samples_post, uint32_t num_shots)
+{
+    memset (hdr, 0, sizeof (*hdr));
+    memcpy (hdr->magic, ACQ_CONTAINER_MAGIC, sizeof (hdr->magic));
+    hdr->version = ACQ_CONTAINER_VERSION;
+    hdr->byte_order = ACQ_CONTAINER_BYTE_ORDER;
+    hdr->header_size = sizeof (*hdr);
+    hdr->chan = chan;
+    hdr->sample_size = sample_size;
+    hdr->num_lanes = ACQ_CONTAINER_NUM_LANES;
+    hdr->lane_size = sample_size/ACQ_CONTAINER_NUM_LANES;
+    hdr->num_samples_pre = num_samples_pre;
+    hdr->num_samples_post = num_samples_post;
+    hdr->num_shots = num_shots;
+
+    hdr->payload_offset = _align (sizeof (*hdr), ACQ_CONTAINER_ALIGN);
+    hdr->payload_size = (uint64_t) (num_samples_pre + num_samples_post)*num_shots*sample_size;
+    hdr->index_offset = _align (hdr->payload_offset + hdr->payload_size,
+            sizeof (acq_container_shot_t));
+    hdr->record_size = _align (hdr->index_offset + num_shots*sizeof (acq_container_shot_t),
+            ACQ_CONTAINER_ALIGN);
+}
+
+static int _write_zeros (curve_fmt_out_t *out, uint64_t size)
+{
+    static const char zeros[ACQ_CONTAINER_ALIGN];
+
+    while (size > 0) {
+        size_t chunk = (size < sizeof (zeros)) ? size : sizeof (zeros);
+        if (curve_fmt_write (out, zeros, chunk) < 0) {
+            return -1;
+        }
+        size -= chunk;
+    }
+    return 0;
+}
+
+int acq_container_begin (curve_fmt_out_t *out, const acq_container_hdr_t *hdr)
+{
+    if (curve_fmt_write (out, hdr, sizeof (*hdr)) < 0) {
+        return -1;
+    }
+    return _write_zeros (out, hdr->payload_offset - sizeof (*hdr));
+}
+
+int acq_container_end (curve_fmt_out_t *out, const acq_container_hdr_t *hdr,
+        uint64_t payload_written)
+{
+    uint64_t offset = hdr->payload_offset + payload_written;
+    if (payload_written > hdr->payload_size) {
+        return -1;
+    }
+
+    if (_write_zeros (out, hdr->index_offset - offset) < 0) {
+        return -1;
+    }
+    offset = hdr->index_offset;
+
+    uint64_t shot_size = hdr->num_shots ? hdr->payload_size/hdr->num_shots : 0;
+    for (uint32_t shot = 0; shot < hdr->num_shots; shot++) {
+        uint64_t shot_start = shot*shot_size;
+        uint64_t shot_written = (payload_written <= shot_start) ? 0 : payload_written - shot_start;
+        acq_container_shot_t entry = {
+            .offset = hdr->payload_offset + shot_start,
+            .size = (shot_written < shot_size) ? shot_written : shot_size
+        };
+        if (curve_fmt_write (out, &entry, sizeof (entry)) < 0) {
+            return -1;
+        }
+        offset += sizeof (entry);
+    }
+
+    if (_write_zeros (out, hdr->record_size - offset) < 0) {
+        return -1;
+    }
+    return curve_fmt_flush (out);
+}
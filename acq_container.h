@@ -0,0 +1,81 @@
+#ifndef _ACQ_CONTAINER_H_
+#define _ACQ_CONTAINER_H_
+
+#include <stdint.h>
+
+#include "curve_fmt.h"
+
+/* Binary capture container.
+ *
+ * A record holds one acquisition:
+ *
+ *   header      acq_container_hdr_t, padded up to payload_offset
+ *   payload     the raw samples, exactly as the board sends them, starting
+ *               at an ACQ_CONTAINER_ALIGN boundary
+ *   index       one acq_container_shot_t per shot, at index_offset
+ *
+ * and is padded up to record_size, a multiple of ACQ_CONTAINER_ALIGN, so
+ * records can be concatenated and the payload of each one can be mmap'ed
+ * and used in place. All offsets are relative to the start of the record
+ * and all fields are in the byte order of the writer, given by byte_order.
+ *
+ * The header and the shot offsets describe the nominal layout. The size of
+ * each shot is the number of its bytes actually received: a shot of a
+ * short transfer is smaller than payload_size/num_shots, and the rest of
+ * its room is zero filled */
+
+#define ACQ_CONTAINER_MAGIC         "HALCSACQ"
+#define ACQ_CONTAINER_VERSION       2
+#define ACQ_CONTAINER_BYTE_ORDER    0x01020304
+#define ACQ_CONTAINER_ALIGN         4096
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t board;
+    uint32_t bpm;
+    uint32_t chan;
+    /* Bytes per sample, with num_lanes lanes of lane_size bytes each */
+    uint32_t sample_size;
+    uint32_t num_lanes;
+    uint32_t lane_size;
+    uint32_t num_samples_pre;
+    uint32_t num_samples_post;
+    uint32_t num_shots;
+    /* Position of the record in a sequence of captures */
+    uint64_t sequence;
+    /* CLOCK_REALTIME [ns] of the start and of the end of the acquisition,
+     * 0 if unknown */
+    int64_t start_ns;
+    int64_t end_ns;
+    uint64_t payload_offset;
+    uint64_t payload_size;
+    uint64_t index_offset;
+    uint64_t record_size;
+    uint8_t reserved[16];
+} acq_container_hdr_t;
+
+typedef struct {
+    uint64_t offset;
+    /* Valid bytes of the shot */
+    uint64_t size;
+} acq_container_shot_t;
+
+/* Fill the header of a capture of num_shots shots of num_samples_pre +
+ * num_samples_post samples and lay out the record. Acquisition board, bpm,
+ * sequence and timestamps are left to the caller */
+void acq_container_hdr_init (acq_container_hdr_t *hdr, uint32_t chan, uint32_t sample_size,
+        uint32_t num_samples_pre, uint32_t num_samples_post, uint32_t num_shots);
+
+/* Write the header and the padding before the payload */
+int acq_container_begin (curve_fmt_out_t *out, const acq_container_hdr_t *hdr);
+
+/* Complete a record whose payload_written bytes of payload were written.
+ * A short payload is zero filled, so the layout stays valid, and the index
+ * gives the bytes written of each shot */
+int acq_container_end (curve_fmt_out_t *out, const acq_container_hdr_t *hdr,
+        uint64_t payload_written);
+
+#endif
@@ -0,0 +1,180 @@
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "acq_metadata.h"
+
+#define ACQ_METADATA_COMMENT_CHAR   '#'
+#define ACQ_METADATA_OPTION_CHAR    '='
+
+void acq_metadata_init (acq_metadata_t *md)
+{
+    memset (md, 0, sizeof (*md));
+}
+
+void acq_metadata_destroy (acq_metadata_t *md)
+{
+    for (size_t i = 0; i < md->num_entries; i++) {
+        free (md->entries[i].key);
+        free (md->entries[i].value);
+    }
+    free (md->entries);
+    acq_metadata_init (md);
+}
+
+static acq_metadata_entry_t *_find (const acq_metadata_t *md, const char *key)
+{
+    for (size_t i = 0; i < md->num_entries; i++) {
+        if (strcmp (md->entries[i].key, key) == 0) {
+            return &md->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/* Take ownership of value */
+static int _set (acq_metadata_t *md, const char *key, char *value)
+{
+    acq_metadata_entry_t *entry = _find (md, key);
+    if (entry != NULL) {
+        free (entry->value);
+        entry->value = value;
+        return 0;
+    }
+
+    if (md->num_entries == md->cap) {
+        size_t cap = (md->cap == 0) ? 64 : 2*md->cap;
+        acq_metadata_entry_t *entries = realloc (md->entries, cap*sizeof (*entries));
+        if (entries == NULL) {
+            free (value);
+            return -1;
+        }
+        md->entries = entries;
+        md->cap = cap;
+    }
+
+    entry = &md->entries[md->num_entries];
+    entry->key = strdup (key);
+    entry->value = value;
+    if (entry->key == NULL) {
+        free (value);
+        return -1;
+    }
+    md->num_entries++;
+    return 0;
+}
+
+/* Remove leading and trailing blanks in place */
+static char *_strip (char *str)
+{
+    while (isspace ((unsigned char) *str)) {
+        str++;
+    }
+    char *end = str + strlen (str);
+    while (end > str && isspace ((unsigned char) end[-1])) {
+        end--;
+    }
+    *end = '\0';
+    return str;
+}
+
+int acq_metadata_load (acq_metadata_t *md, const char *file)
+{
+    FILE *fp = fopen (file, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    int err = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    while (err == 0 && getline (&line, &line_cap, fp) != -1) {
+        char *comment = strchr (line, ACQ_METADATA_COMMENT_CHAR);
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char *sep = strchr (line, ACQ_METADATA_OPTION_CHAR);
+        if (sep == NULL) {
+            continue;
+        }
+        *sep = '\0';
+
+        char *value = strdup (_strip (sep + 1));
+        err = (value == NULL) ? -1 : _set (md, _strip (line), value);
+    }
+
+    free (line);
+    fclose (fp);
+    return err;
+}
+
+const char *acq_metadata_get (const acq_metadata_t *md, const char *key)
+{
+    acq_metadata_entry_t *entry = _find (md, key);
+    return (entry != NULL) ? entry->value : NULL;
+}
+
+int acq_metadata_set (acq_metadata_t *md, const char *key, const char *fmt, ...)
+{
+    va_list args;
+    va_start (args, fmt);
+    int len = vsnprintf (NULL, 0, fmt, args);
+    va_end (args);
+
+    char *value = (len < 0) ? NULL : malloc (len + 1);
+    if (value == NULL) {
+        return -1;
+    }
+    va_start (args, fmt);
+    vsnprintf (value, len + 1, fmt, args);
+    va_end (args);
+    return _set (md, key, value);
+}
+
+void acq_metadata_unset (acq_metadata_t *md, const char *key)
+{
+    acq_metadata_entry_t *entry = _find (md, key);
+    if (entry != NULL) {
+        free (entry->key);
+        free (entry->value);
+        *entry = md->entries[--md->num_entries];
+    }
+}
+
+static int _entry_cmp (const void *a, const void *b)
+{
+    return strcmp (((const acq_metadata_entry_t *) a)->key, ((const acq_metadata_entry_t *) b)->key);
+}
+
+int acq_metadata_write (const acq_metadata_t *md, const char *file)
+{
+    acq_metadata_entry_t *sorted = malloc ((md->num_entries + 1)*sizeof (*sorted));
+    char *tmp_file = malloc (strlen (file) + sizeof (".tmp"));
+    if (sorted == NULL || tmp_file == NULL) {
+        free (sorted);
+        free (tmp_file);
+        return -1;
+    }
+    sprintf (tmp_file, "%s.tmp", file);
+    memcpy (sorted, md->entries, md->num_entries*sizeof (*sorted));
+    qsort (sorted, md->num_entries, sizeof (*sorted), _entry_cmp);
+
+    int err = 0;
+    FILE *fp = fopen (tmp_file, "w");
+    if (fp == NULL) {
+        err = -1;
+    } else {
+        for (size_t i = 0; i < md->num_entries; i++) {
+            fprintf (fp, "%s = %s\n", sorted[i].key, sorted[i].value);
+        }
+        if (fclose (fp) != 0 || rename (tmp_file, file) != 0) {
+            remove (tmp_file);
+            err = -1;
+        }
+    }
+
+    free (tmp_file);
+    free (sorted);
+    return err;
+}
@@ -0,0 +1,41 @@
+#ifndef _ACQ_METADATA_H_
+#define _ACQ_METADATA_H_
+
+#include <stddef.h>
+
+/* Acquisition metadata sidecar: "key = value" lines, as in
+ * scripts/metadata_templates. Text after a '#' is a comment and lines
+ * without a '=' are ignored. Keys are unique and written sorted */
+
+typedef struct {
+    char *key;
+    char *value;
+} acq_metadata_entry_t;
+
+typedef struct {
+    acq_metadata_entry_t *entries;
+    size_t num_entries;
+    size_t cap;
+} acq_metadata_t;
+
+void acq_metadata_init (acq_metadata_t *md);
+void acq_metadata_destroy (acq_metadata_t *md);
+
+/* Add the entries of a template file. Returns -1 if it can not be read */
+int acq_metadata_load (acq_metadata_t *md, const char *file);
+
+/* Value of key, NULL if it is not set */
+const char *acq_metadata_get (const acq_metadata_t *md, const char *key);
+
+/* Set key to a printf formatted value, replacing any previous value */
+int acq_metadata_set (acq_metadata_t *md, const char *key, const char *fmt, ...)
+    __attribute__ ((format (printf, 3, 4)));
+
+/* Remove key, if set */
+void acq_metadata_unset (acq_metadata_t *md, const char *key);
+
+/* Write all the entries sorted by key. The file is replaced atomically, so
+ * it may be the template it was loaded from */
+int acq_metadata_write (const acq_metadata_t *md, const char *file);
+
+#endif
@@ -0,0 +1,177 @@
+#include <pthread.h>
+#include "acq_stream.h"
+#include "client_stats.h"
+
+typedef struct {
+    uint32_t *data;
+    uint32_t bytes;
+} acq_stream_buf_t;
+
+typedef struct {
+    const acq_stream_cfg_t *cfg;
+    acq_stream_buf_t *bufs;
+    /* Ring of filled buffers: [tail, tail+count) */
+    unsigned head;
+    unsigned tail;
+    unsigned count;
+    int done;
+    int stop;
+    halcs_client_err_e err;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t freed;
+} acq_stream_t;
+
+static void *_acq_stream_fetcher (void *arg)
+{
+    acq_stream_t *self = (acq_stream_t *) arg;
+    const acq_stream_cfg_t *cfg = self->cfg;
+    halcs_client_err_e err = HALCS_CLIENT_SUCCESS;
+    uint64_t fetched = 0;
+
+    for (uint32_t block_n = 0; fetched < cfg->total_bytes; block_n++) {
+        /* Wait for a free buffer */
+        pthread_mutex_lock (&self->lock);
+        while (self->count == cfg->num_bufs && !self->stop) {
+            pthread_cond_wait (&self->freed, &self->lock);
+        }
+        int stop = self->stop;
+        acq_stream_buf_t *buf = &self->bufs[self->head];
+        pthread_mutex_unlock (&self->lock);
+
+        if (stop || zctx_interrupted) {
+            break;
+        }
+
+        acq_trans_t acq_trans = {
+            .req = {
+                .chan = cfg->chan,
+            },
+            .block = {
+                .idx = block_n,
+                .data = buf->data,
+                .data_size = ACQ_STREAM_BLOCK_SIZE
+            }
+        };
+
+        int64_t start = client_stats_now ();
+        err = acq_get_data_block (cfg->acq_client, cfg->service, &acq_trans);
+        client_stats_record (STATS_ACQ_BLOCK, start, acq_trans.block.bytes_read);
+        if (err != HALCS_CLIENT_SUCCESS || acq_trans.block.bytes_read == 0) {
+            break;
+        }
+
+        /* The last block may carry more than what was asked for */
+        buf->bytes = acq_trans.block.bytes_read;
+        if (fetched + buf->bytes > cfg->total_bytes) {
+            buf->bytes = cfg->total_bytes - fetched;
+        }
+        fetched += buf->bytes;
+
+        pthread_mutex_lock (&self->lock);
+        self->head = (self->head + 1) % cfg->num_bufs;
+        self->count++;
+        pthread_cond_signal (&self->filled);
+        pthread_mutex_unlock (&self->lock);
+    }
+
+    pthread_mutex_lock (&self->lock);
+    self->err = err;
+    self->done = 1;
+    pthread_cond_signal (&self->filled);
+    pthread_mutex_unlock (&self->lock);
+    return NULL;
+}
+
+halcs_client_err_e acq_stream_curve (const acq_stream_cfg_t *cfg,
+        acq_stream_sink_fn *sink, void *sink_ctx, uint64_t *bytes_streamed)
+{
+    halcs_client_err_e err = HALCS_CLIENT_SUCCESS;
+    uint64_t streamed = 0;
+
+    if (cfg->num_bufs < 2 || cfg->num_bufs > ACQ_STREAM_MAX_NUM_BUFS) {
+        return HALCS_CLIENT_ERR_INV_PARAM;
+    }
+
+    acq_stream_t self = {
+        .cfg = cfg,
+        .err = HALCS_CLIENT_SUCCESS
+    };
+
+    self.bufs = zmalloc (cfg->num_bufs*sizeof (acq_stream_buf_t));
+    if (self.bufs == NULL) {
+        return HALCS_CLIENT_ERR_ALLOC;
+    }
+
+    /* Block buffers are fully overwritten by the transfer, so there is
+     * no need to zero them */
+    for (unsigned i = 0; i < cfg->num_bufs; i++) {
+        self.bufs[i].data = malloc (ACQ_STREAM_BLOCK_SIZE);
+        if (self.bufs[i].data == NULL) {
+            err = HALCS_CLIENT_ERR_ALLOC;
+            goto err_buf_alloc;
+        }
+    }
+
+    pthread_mutex_init (&self.lock, NULL);
+    pthread_cond_init (&self.filled, NULL);
+    pthread_cond_init (&self.freed, NULL);
+
+    pthread_t fetcher;
+    if (pthread_create (&fetcher, NULL, _acq_stream_fetcher, &self) != 0) {
+        err = HALCS_CLIENT_ERR_ALLOC;
+        goto err_thread;
+    }
+
+    while (1) {
+        pthread_mutex_lock (&self.lock);
+        while (self.count == 0 && !self.done) {
+            pthread_cond_wait (&self.filled, &self.lock);
+        }
+        if (self.count == 0) {
+            pthread_mutex_unlock (&self.lock);
+            break;
+        }
+        acq_stream_buf_t *buf = &self.bufs[self.tail];
+        pthread_mutex_unlock (&self.lock);
+
+        /* The fetcher never touches a filled buffer, so the sink runs
+         * without holding the lock */
+        int sink_err = sink (sink_ctx, buf->data, buf->bytes);
+        streamed += buf->bytes;
+
+        pthread_mutex_lock (&self.lock);
+        self.tail = (self.tail + 1) % cfg->num_bufs;
+        self.count--;
+        if (sink_err || zctx_interrupted) {
+            self.stop = 1;
+        }
+        pthread_cond_signal (&self.freed);
+        pthread_mutex_unlock (&self.lock);
+
+        if (sink_err || zctx_interrupted) {
+            err = zctx_interrupted ? HALCS_CLIENT_INT : HALCS_CLIENT_ERR_SERVER;
+            break;
+        }
+    }
+
+    pthread_join (fetcher, NULL);
+    if (err == HALCS_CLIENT_SUCCESS) {
+        err = self.err;
+    }
+
+err_thread:
+    pthread_cond_destroy (&self.freed);
+    pthread_cond_destroy (&self.filled);
+    pthread_mutex_destroy (&self.lock);
+err_buf_alloc:
+    for (unsigned i = 0; i < cfg->num_bufs; i++) {
+        free (self.bufs[i].data);
+    }
+    free (self.bufs);
+
+    if (bytes_streamed != NULL) {
+        *bytes_streamed = streamed;
+    }
+    return err;
+}
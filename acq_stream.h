@@ -0,0 +1,39 @@
+#ifndef _ACQ_STREAM_H_
+#define _ACQ_STREAM_H_
+
+#include <acq_client.h>
+
+/* Size of a single data block as served by the ACQ module. Use the
+ * library definition if it is exported */
+#ifdef BLOCK_SIZE
+#define ACQ_STREAM_BLOCK_SIZE       BLOCK_SIZE
+#else
+#define ACQ_STREAM_BLOCK_SIZE       131072
+#endif
+
+#define ACQ_STREAM_DFLT_NUM_BUFS    4
+#define ACQ_STREAM_MAX_NUM_BUFS     64
+
+/* Called, in order, for every block retrieved from the server. A non-zero
+ * return value aborts the stream */
+typedef int (acq_stream_sink_fn) (void *ctx, uint32_t *data, uint32_t size);
+
+typedef struct {
+    acq_client_t *acq_client;
+    char *service;
+    uint32_t chan;
+    /* Expected curve size in bytes. The stream stops after this many bytes
+     * or at the first empty block */
+    uint64_t total_bytes;
+    /* Number of block buffers in the pool, [2, ACQ_STREAM_MAX_NUM_BUFS] */
+    unsigned num_bufs;
+} acq_stream_cfg_t;
+
+/* Retrieve a whole curve block by block with acq_get_data_block. A fetcher
+ * thread fills a bounded pool of reusable block buffers while the calling
+ * thread hands the previously filled ones to the sink, so network transfer
+ * and output overlap and memory usage does not depend on the curve size */
+halcs_client_err_e acq_stream_curve (const acq_stream_cfg_t *cfg,
+        acq_stream_sink_fn *sink, void *sink_ctx, uint64_t *bytes_streamed);
+
+#endif
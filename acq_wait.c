@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "acq_wait.h"
+#include "client_stats.h"
+
+/* Sleep at most this fraction of the time left until the expected end */
+#define ACQ_WAIT_CLOSE_IN_NUM       7
+#define ACQ_WAIT_CLOSE_IN_DEN       8
+
+/* Nominal decimation of each acquisition channel from the ADC clock: ADC
+ * and mixer at the ADC rate, then TBT, FOFB and monitoring rates */
+static const uint32_t acq_chan_decim [] = {
+    1, 1, 1, 1,
+    35, 35, 35, 35, 35,
+    980, 980, 980, 980, 980,
+    98000, 98000,
+    980000
+};
+
+int64_t acq_wait_expected_ns (uint32_t chan, uint64_t num_samples, double rate)
+{
+    if (rate <= 0) {
+        if (chan >= sizeof (acq_chan_decim)/sizeof (acq_chan_decim[0])) {
+            return 0;
+        }
+        rate = ACQ_NOMINAL_ADC_CLK_HZ/acq_chan_decim[chan];
+    }
+    return (int64_t) (num_samples/rate*1e9);
+}
+
+static void _sleep_ns (int64_t ns)
+{
+    struct timespec ts = {
+        .tv_sec = ns / 1000000000,
+        .tv_nsec = ns % 1000000000
+    };
+    while (nanosleep (&ts, &ts) != 0 && errno == EINTR && !zctx_interrupted);
+}
+
+halcs_client_err_e acq_wait_ready (const acq_wait_cfg_t *cfg, acq_wait_result_t *result)
+{
+    int64_t now = client_stats_now ();
+    int64_t start = (cfg->start_ns != 0) ? cfg->start_ns : now;
+    int64_t deadline = (cfg->timeout >= 0) ? now + (int64_t) cfg->timeout*1000000 : INT64_MAX;
+    /* With an unknown start, e.g. an acquisition armed by an earlier
+     * command, the end may already be near or past: back off right away
+     * rather than sleep through a whole acquisition time */
+    int64_t expected_end = (cfg->start_ns != 0) ? start + cfg->expected_ns : start;
+
+    int64_t period = ACQ_WAIT_MIN_PERIOD_NS;
+    int64_t last_check = start;
+
+    memset (result, 0, sizeof (*result));
+    while (1) {
+        int64_t check_start = client_stats_now ();
+        halcs_client_err_e err = acq_check (cfg->acq_client, cfg->service);
+        client_stats_record (STATS_ACQ_CHECK, check_start, 0);
+        result->num_checks++;
+
+        now = client_stats_now ();
+        if (err == HALCS_CLIENT_SUCCESS) {
+            result->ready_ns = now - start;
+            result->resolution_ns = now - last_check;
+            return HALCS_CLIENT_SUCCESS;
+        }
+        last_check = check_start;
+
+        if (zctx_interrupted) {
+            return HALCS_CLIENT_INT;
+        }
+        if (now >= deadline) {
+            return HALCS_CLIENT_ERR_TIMEOUT;
+        }
+
+        int64_t sleep_ns;
+        if (expected_end - now > ACQ_WAIT_MIN_PERIOD_NS) {
+            /* Still acquiring: close in on the expected end */
+            sleep_ns = (expected_end - now)*ACQ_WAIT_CLOSE_IN_NUM/ACQ_WAIT_CLOSE_IN_DEN;
+            if (sleep_ns < ACQ_WAIT_MIN_PERIOD_NS) {
+                sleep_ns = ACQ_WAIT_MIN_PERIOD_NS;
+            }
+        } else {
+            /* Overdue, e.g. waiting for a trigger: back off, so the data
+             * is seen at most about as late as it was overdue */
+            sleep_ns = period;
+            period = (2*period < ACQ_WAIT_MAX_PERIOD_NS) ? 2*period : ACQ_WAIT_MAX_PERIOD_NS;
+        }
+
+        if (sleep_ns > deadline - now) {
+            sleep_ns = deadline - now;
+        }
+        _sleep_ns (sleep_ns);
+    }
+}
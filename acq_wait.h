@@ -0,0 +1,49 @@
+#ifndef _ACQ_WAIT_H_
+#define _ACQ_WAIT_H_
+
+#include <acq_client.h>
+
+/* Shortest and longest interval between two acq_check calls [ns] */
+#define ACQ_WAIT_MIN_PERIOD_NS      50000
+#define ACQ_WAIT_MAX_PERIOD_NS      5000000
+
+typedef struct {
+    acq_client_t *acq_client;
+    char *service;
+    /* CLOCK_MONOTONIC [ns] of the acq_start, 0 if unknown */
+    int64_t start_ns;
+    /* Expected time from acq_start until the data is ready [ns], 0 if
+     * unknown */
+    int64_t expected_ns;
+    /* [ms], -1 to wait forever */
+    int timeout;
+} acq_wait_cfg_t;
+
+typedef struct {
+    /* From acq_start (or from the call, if start_ns is unknown) to the
+     * check that found the data ready [ns] */
+    int64_t ready_ns;
+    /* The data became ready at most this long before it was seen: time
+     * since the previous check [ns] */
+    int64_t resolution_ns;
+    uint32_t num_checks;
+} acq_wait_result_t;
+
+/* Nominal ADC sampling clock [Hz], clockgen_clk_freq of the evaluation
+ * setup in scripts/metadata_templates */
+#define ACQ_NOMINAL_ADC_CLK_HZ      113040445.0
+
+/* Expected time from acq_start until num_samples samples of chan are
+ * ready [ns], 0 if unknown. rate is the sample rate of chan [Hz], 0 for
+ * the nominal one */
+int64_t acq_wait_expected_ns (uint32_t chan, uint64_t num_samples, double rate);
+
+/* Wait until the acquisition is over. The first check is immediate. Then
+ * the wait sleeps through most of the expected acquisition time, closing
+ * in on its end, and once it is overdue checks with an interval doubling
+ * from ACQ_WAIT_MIN_PERIOD_NS up to ACQ_WAIT_MAX_PERIOD_NS, so short
+ * captures are seen quickly and long or late ones cost few round trips.
+ * If start_ns is unknown, the wait goes straight to the backoff */
+halcs_client_err_e acq_wait_ready (const acq_wait_cfg_t *cfg, acq_wait_result_t *result);
+
+#endif
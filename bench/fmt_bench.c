@@ -0,0 +1,385 @@
+/* Output throughput benchmark.
+ *
+ * Formats synthetic int16x4 (ADC) and int32x4 (IQ/amplitude/position)
+ * curves with curve_fmt and with the former per-row printf, checks that
+ * both produce the same bytes and reports the throughput in MB/s of
+ * generated text. With --threads, curve_fmt formatting on a pool of that
+ * many threads is measured and checked as well. Binary output through
+ * curve_fmt and fwrite is measured as well, in MB/s of raw samples, and so
+ * is the de-interleaving into columns, SIMD against plain loops. With
+ * --json, one JSON object per measurement is printed instead */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "curve_deint.h"
+#include "curve_fmt.h"
+
+#define DFLT_NUM_SAMPLES            1000000
+#define DFLT_NUM_RUNS               5
+#define DFLT_NUM_THREADS            1
+#define DFLT_OUTPUT                 "/dev/null"
+
+typedef enum {
+    LAYOUT_INT16X4 = 0,
+    LAYOUT_INT32X4
+} layout_e;
+
+static double _now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/* Deterministic data covering all field widths, including the
+ * extremes of each type */
+static void _fill (layout_e layout, void *data, size_t rows)
+{
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < rows*4; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        int shift = x % 31;
+        int32_t v = (int32_t) x >> shift;
+        if (layout == LAYOUT_INT16X4) {
+            ((int16_t *) data)[i] = (i % 1009 == 0) ? -32768 : (int16_t) v;
+        } else {
+            ((int32_t *) data)[i] = (i % 1009 == 0) ? INT32_MIN : v;
+        }
+    }
+}
+
+static int32_t _get (layout_e layout, const void *data, size_t i)
+{
+    return (layout == LAYOUT_INT16X4) ? ((const int16_t *) data)[i] :
+        ((const int32_t *) data)[i];
+}
+
+static int _check (layout_e layout, const void *data, size_t rows)
+{
+    char *fast = malloc (rows*CURVE_FMT_MAX_ROW_LEN);
+    char *ref = malloc (rows*CURVE_FMT_MAX_ROW_LEN + 1);
+    size_t ref_len = 0;
+
+    for (size_t i = 0; i < rows; i++) {
+        ref_len += sprintf (ref + ref_len, "%8d\t %8d\t %8d\t %8d\n",
+                _get (layout, data, i*4), _get (layout, data, i*4+1),
+                _get (layout, data, i*4+2), _get (layout, data, i*4+3));
+    }
+
+    size_t fast_len = (layout == LAYOUT_INT16X4) ?
+        curve_fmt_rows_i16x4 (fast, data, rows) :
+        curve_fmt_rows_i32x4 (fast, data, rows);
+
+    int ok = (fast_len == ref_len) && memcmp (fast, ref, ref_len) == 0;
+    free (fast);
+    free (ref);
+    return ok;
+}
+
+/* Whether formatting on a pool gives the same bytes as in a single thread */
+static int _check_par (layout_e layout, const void *data, size_t rows, unsigned threads)
+{
+    FILE *tmp = tmpfile ();
+    char *ref = malloc (rows*CURVE_FMT_MAX_ROW_LEN);
+    char *par = malloc (rows*CURVE_FMT_MAX_ROW_LEN);
+    int ok = 0;
+
+    if (tmp != NULL && ref != NULL && par != NULL) {
+        curve_fmt_pool_t pool;
+        curve_fmt_pool_init (&pool, threads);
+        curve_fmt_out_t out;
+        curve_fmt_out_init (&out, fileno (tmp), CURVE_FMT_DFLT_BUF_SIZE);
+        out.pool = &pool;
+        if (layout == LAYOUT_INT16X4) {
+            curve_fmt_text_i16x4 (&out, data, rows);
+        } else {
+            curve_fmt_text_i32x4 (&out, data, rows);
+        }
+        curve_fmt_flush (&out);
+        curve_fmt_out_destroy (&out);
+        curve_fmt_pool_destroy (&pool);
+
+        size_t ref_len = (layout == LAYOUT_INT16X4) ?
+            curve_fmt_rows_i16x4 (ref, data, rows) :
+            curve_fmt_rows_i32x4 (ref, data, rows);
+        rewind (tmp);
+        size_t par_len = fread (par, 1, rows*CURVE_FMT_MAX_ROW_LEN, tmp);
+        ok = (par_len == ref_len) && memcmp (par, ref, ref_len) == 0;
+    }
+
+    if (tmp != NULL) {
+        fclose (tmp);
+    }
+    free (ref);
+    free (par);
+    return ok;
+}
+
+static double _run_fmt (layout_e layout, const void *data, size_t rows, int fd,
+        curve_fmt_pool_t *pool)
+{
+    curve_fmt_out_t out;
+    curve_fmt_out_init (&out, fd, CURVE_FMT_DFLT_BUF_SIZE);
+    out.pool = pool;
+
+    double start = _now ();
+    if (layout == LAYOUT_INT16X4) {
+        curve_fmt_text_i16x4 (&out, data, rows);
+    } else {
+        curve_fmt_text_i32x4 (&out, data, rows);
+    }
+    curve_fmt_flush (&out);
+    double elapsed = _now () - start;
+
+    curve_fmt_out_destroy (&out);
+    return elapsed;
+}
+
+static double _run_printf (layout_e layout, const void *data, size_t rows, FILE *fp)
+{
+    double start = _now ();
+    for (size_t i = 0; i < rows; i++) {
+        fprintf (fp, "%8d\t %8d\t %8d\t %8d\n",
+                _get (layout, data, i*4), _get (layout, data, i*4+1),
+                _get (layout, data, i*4+2), _get (layout, data, i*4+3));
+    }
+    fflush (fp);
+    return _now () - start;
+}
+
+static double _run_bin_fmt (const void *data, size_t size, int fd)
+{
+    curve_fmt_out_t out;
+    curve_fmt_out_init (&out, fd, CURVE_FMT_DFLT_BUF_SIZE);
+
+    double start = _now ();
+    curve_fmt_write (&out, data, size);
+    curve_fmt_flush (&out);
+    double elapsed = _now () - start;
+
+    curve_fmt_out_destroy (&out);
+    return elapsed;
+}
+
+static double _run_bin_fwrite (const void *data, size_t size, FILE *fp)
+{
+    double start = _now ();
+    fwrite (data, 1, size, fp);
+    fflush (fp);
+    return _now () - start;
+}
+
+/* De-interleave into dst, with SIMD or with plain loops */
+static double _run_deint (layout_e layout, const void *data, size_t rows, void *dst, int simd)
+{
+    double start = _now ();
+    if (layout == LAYOUT_INT16X4) {
+        (simd ? curve_deint_i16x4 : curve_deint_i16x4_scalar) (dst, data, rows);
+    } else {
+        (simd ? curve_deint_i32x4 : curve_deint_i32x4_scalar) (dst, data, rows);
+    }
+    return _now () - start;
+}
+
+static void _print_json (const char *layout, const char *format, const char *impl, size_t rows,
+        size_t bytes, double secs)
+{
+    printf ("{\"bench\": \"output\", \"layout\": \"%s\", \"format\": \"%s\", "
+            "\"impl\": \"%s\", \"samples\": %zu, \"bytes\": %zu, \"secs\": %.9f, "
+            "\"mb_per_s\": %.3f}\n", layout, format, impl, rows, bytes, secs, bytes/secs/1e6);
+}
+
+static size_t _text_size (layout_e layout, const void *data, size_t rows)
+{
+    char *buf = malloc (CURVE_FMT_MAX_ROW_LEN*1024);
+    size_t size = 0;
+    for (size_t i = 0; i < rows; i += 1024) {
+        size_t n = (rows - i < 1024) ? rows - i : 1024;
+        size += (layout == LAYOUT_INT16X4) ?
+            curve_fmt_rows_i16x4 (buf, (const int16_t *) data + i*4, n) :
+            curve_fmt_rows_i32x4 (buf, (const int32_t *) data + i*4, n);
+    }
+    free (buf);
+    return size;
+}
+
+static void print_usage (const char *program_name, FILE *stream, int exit_code)
+{
+    fprintf (stream, "Usage:  %s options\n", program_name);
+    fprintf (stream,
+            "  -h  --help                       Display this usage information.\n"
+            "  -n  --samples <number>           Number of samples per layout (default %d)\n"
+            "  -r  --runs <number>              Number of timed runs, best one is reported (default %d)\n"
+            "  -o  --output <file>              Output file (default " DFLT_OUTPUT ")\n"
+            "  -t  --threads <number>           Also measure formatting on this many threads (default %d)\n"
+            "  -j  --json                       Print one JSON object per measurement\n",
+            DFLT_NUM_SAMPLES, DFLT_NUM_RUNS, DFLT_NUM_THREADS);
+    exit (exit_code);
+}
+
+int main (int argc, char *argv [])
+{
+    size_t num_samples = DFLT_NUM_SAMPLES;
+    int runs = DFLT_NUM_RUNS;
+    unsigned threads = DFLT_NUM_THREADS;
+    const char *output = DFLT_OUTPUT;
+    int json = 0;
+    int ch;
+
+    static struct option long_options[] = {
+        {"help",        no_argument,         NULL, 'h'},
+        {"samples",     required_argument,   NULL, 'n'},
+        {"runs",        required_argument,   NULL, 'r'},
+        {"output",      required_argument,   NULL, 'o'},
+        {"threads",     required_argument,   NULL, 't'},
+        {"json",        no_argument,         NULL, 'j'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((ch = getopt_long (argc, argv, "hn:r:o:t:j", long_options, NULL)) != -1) {
+        switch (ch) {
+            case 'n':
+                num_samples = strtoul (optarg, NULL, 10);
+                break;
+            case 'r':
+                runs = strtol (optarg, NULL, 10);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 't':
+                threads = strtoul (optarg, NULL, 10);
+                break;
+            case 'j':
+                json = 1;
+                break;
+            case 'h':
+                print_usage (argv[0], stdout, EXIT_SUCCESS);
+                break;
+            default:
+                print_usage (argv[0], stderr, EXIT_FAILURE);
+        }
+    }
+
+    if (num_samples == 0 || runs <= 0 || threads == 0) {
+        print_usage (argv[0], stderr, EXIT_FAILURE);
+    }
+
+    int fd = open (output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    FILE *fp = fopen (output, "w");
+    if (fd < 0 || fp == NULL) {
+        perror (output);
+        return EXIT_FAILURE;
+    }
+
+    static const struct {
+        layout_e layout;
+        const char *name;
+        size_t sample_size;
+    } layouts[] = {
+        {LAYOUT_INT16X4, "int16x4", 4*sizeof (int16_t)},
+        {LAYOUT_INT32X4, "int32x4", 4*sizeof (int32_t)},
+    };
+
+    curve_fmt_pool_t pool;
+    curve_fmt_pool_init (&pool, threads);
+
+    int ret = EXIT_SUCCESS;
+    for (size_t l = 0; l < sizeof (layouts)/sizeof (layouts[0]); l++) {
+        layout_e layout = layouts[l].layout;
+        size_t rows = num_samples;
+        void *data = malloc (rows*layouts[l].sample_size);
+        _fill (layout, data, rows);
+
+        int identical = _check (layout, data, rows);
+        if (threads > 1) {
+            identical = identical && _check_par (layout, data, rows, threads);
+        }
+        size_t text_size = _text_size (layout, data, rows);
+
+        size_t bin_size = rows*layouts[l].sample_size;
+
+        void *columns = malloc (bin_size);
+        void *columns_ref = malloc (bin_size);
+        _run_deint (layout, data, rows, columns, 1);
+        _run_deint (layout, data, rows, columns_ref, 0);
+        identical = identical && memcmp (columns, columns_ref, bin_size) == 0;
+
+        double best_fmt = 0, best_par = 0, best_printf = 0, best_bin_fmt = 0, best_bin_fwrite = 0;
+        double best_deint = 0, best_deint_scalar = 0;
+        for (int r = 0; r < runs; r++) {
+            lseek (fd, 0, SEEK_SET);
+            double t = _run_fmt (layout, data, rows, fd, NULL);
+            best_fmt = (r == 0 || t < best_fmt) ? t : best_fmt;
+
+            if (threads > 1) {
+                lseek (fd, 0, SEEK_SET);
+                t = _run_fmt (layout, data, rows, fd, &pool);
+                best_par = (r == 0 || t < best_par) ? t : best_par;
+            }
+
+            rewind (fp);
+            t = _run_printf (layout, data, rows, fp);
+            best_printf = (r == 0 || t < best_printf) ? t : best_printf;
+
+            lseek (fd, 0, SEEK_SET);
+            t = _run_bin_fmt (data, bin_size, fd);
+            best_bin_fmt = (r == 0 || t < best_bin_fmt) ? t : best_bin_fmt;
+
+            rewind (fp);
+            t = _run_bin_fwrite (data, bin_size, fp);
+            best_bin_fwrite = (r == 0 || t < best_bin_fwrite) ? t : best_bin_fwrite;
+
+            t = _run_deint (layout, data, rows, columns, 1);
+            best_deint = (r == 0 || t < best_deint) ? t : best_deint;
+
+            t = _run_deint (layout, data, rows, columns_ref, 0);
+            best_deint_scalar = (r == 0 || t < best_deint_scalar) ? t : best_deint_scalar;
+        }
+        free (columns);
+        free (columns_ref);
+
+        if (json) {
+            _print_json (layouts[l].name, "text", "curve_fmt", rows, text_size, best_fmt);
+            if (threads > 1) {
+                _print_json (layouts[l].name, "text", "curve_fmt_par", rows, text_size, best_par);
+            }
+            _print_json (layouts[l].name, "text", "printf", rows, text_size, best_printf);
+            _print_json (layouts[l].name, "binary", "curve_fmt", rows, bin_size, best_bin_fmt);
+            _print_json (layouts[l].name, "binary", "fwrite", rows, bin_size, best_bin_fwrite);
+            _print_json (layouts[l].name, "columns", "curve_deint", rows, bin_size, best_deint);
+            _print_json (layouts[l].name, "columns", "scalar", rows, bin_size, best_deint_scalar);
+        } else {
+            printf ("%s: %zu samples, %.1f MB text, curve_fmt %.1f MB/s, printf %.1f MB/s, "
+                    "speedup %.1fx, output %s\n",
+                    layouts[l].name, rows, text_size/1e6,
+                    text_size/best_fmt/1e6, text_size/best_printf/1e6,
+                    best_printf/best_fmt, identical ? "identical" : "DIFFERS");
+            if (threads > 1) {
+                printf ("%s: curve_fmt on %u threads %.1f MB/s, speedup %.1fx\n",
+                        layouts[l].name, threads, text_size/best_par/1e6, best_fmt/best_par);
+            }
+            printf ("%s: %.1f MB binary, curve_fmt %.1f MB/s, fwrite %.1f MB/s\n",
+                    layouts[l].name, bin_size/1e6, bin_size/best_bin_fmt/1e6,
+                    bin_size/best_bin_fwrite/1e6);
+            printf ("%s: columns, curve_deint %.1f MB/s, scalar %.1f MB/s\n",
+                    layouts[l].name, bin_size/best_deint/1e6, bin_size/best_deint_scalar/1e6);
+        }
+
+        if (!identical) {
+            ret = EXIT_FAILURE;
+        }
+        free (data);
+    }
+
+    curve_fmt_pool_destroy (&pool);
+    fclose (fp);
+    close (fd);
+    return ret;
+}
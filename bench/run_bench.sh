@@ -0,0 +1,161 @@
+#!/usr/bin/env bash
+
+# Benchmark suite: output throughput per sample layout, end-to-end --fullacq
+# time vs. number of samples and call_list rate against the mock server, and
+# process cold-start time.
+#
+# Every measurement is appended to the results file as one JSON object per
+# line, tagged with the run date and git revision, so runs can be compared
+# over time.
+
+set -u
+
+# Defaults
+CLIENT=./client
+MOCK=mock/halcs_mock
+CHECK_MOCK=$(dirname "$0")/../mock/check_mock.sh
+FMT_BENCH=bench/fmt_bench
+RESULTS=bench/results.jsonl
+RUNS=5
+SAMPLES_LIST="1000 10000 100000 1000000"
+CHAN_LIST="0 16"
+CALLS_LIST="1 10 100"
+FMT_SAMPLES=1000000
+FMT_THREADS=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+
+usage() {
+    echo "Usage: $0 [options]"
+    echo "  -c <client>          Client program (default ${CLIENT})"
+    echo "  -m <mock>            Mock server (default ${MOCK})"
+    echo "  -f <fmt_bench>       Output benchmark (default ${FMT_BENCH})"
+    echo "  -o <file>            Results file, appended to (default ${RESULTS})"
+    echo "  -r <runs>            Runs per measurement, the best one is kept (default ${RUNS})"
+    echo "  -s <list>            Sample counts of --fullacq (default \"${SAMPLES_LIST}\")"
+    echo "  -H <list>            Acquisition channels of --fullacq (default \"${CHAN_LIST}\")"
+    echo "  -n <list>            Functions per call_list (default \"${CALLS_LIST}\")"
+    echo "  -t <threads>         Text formatting threads of the output benchmark (default ${FMT_THREADS})"
+}
+
+while getopts "hc:m:f:o:r:s:H:n:t:" opt; do
+    case ${opt} in
+        c) CLIENT=${OPTARG} ;;
+        m) MOCK=${OPTARG} ;;
+        f) FMT_BENCH=${OPTARG} ;;
+        o) RESULTS=${OPTARG} ;;
+        r) RUNS=${OPTARG} ;;
+        s) SAMPLES_LIST=${OPTARG} ;;
+        H) CHAN_LIST=${OPTARG} ;;
+        n) CALLS_LIST=${OPTARG} ;;
+        t) FMT_THREADS=${OPTARG} ;;
+        h) usage; exit 0 ;;
+        *) usage; exit 1 ;;
+    esac
+done
+
+TMP_DIR=$(mktemp -d)
+ENDPOINT="ipc://${TMP_DIR}/broker"
+MOCK_PID=
+
+cleanup() {
+    if [ -n "${MOCK_PID}" ]; then
+        kill -TERM ${MOCK_PID} 2>/dev/null
+        wait ${MOCK_PID} 2>/dev/null
+    fi
+    rm -rf "${TMP_DIR}"
+}
+trap cleanup EXIT
+
+DATE=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+REV=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+# Append a result: emit <json fields>
+emit() {
+    echo "{\"date\": \"${DATE}\", \"rev\": \"${REV}\", $1}" | tee -a "${RESULTS}"
+}
+
+# Best wall time [s] of RUNS executions of a command, or "null" if it fails
+best_time() {
+    local best=
+    for ((r = 0; r < RUNS; r++)); do
+        local start=$(date +%s%N)
+        "$@" > /dev/null 2>&1 || { echo null; return; }
+        local elapsed=$(( $(date +%s%N) - start ))
+        if [ -z "${best}" ] || [ ${elapsed} -lt ${best} ]; then
+            best=${elapsed}
+        fi
+    done
+    awk "BEGIN { printf \"%.6f\", ${best}/1e9 }"
+}
+
+# A client and mock that do not understand each other would only show as
+# failed runs: check them before timing anything
+"${CHECK_MOCK}" -c "${CLIENT}" -m "${MOCK}" || exit 1
+
+########################################
+# Output throughput per sample layout
+########################################
+# fmt_bench prints complete objects: merge their fields with the common ones
+"${FMT_BENCH}" -j -n ${FMT_SAMPLES} -r ${RUNS} -t ${FMT_THREADS} -o "${TMP_DIR}/fmt_out" | while read -r line; do
+    fields=${line#\{}
+    emit "${fields%\}}"
+done
+
+########################################
+# Cold start, without a broker
+########################################
+secs=$(best_time "${CLIENT}" -h)
+emit "\"bench\": \"cold_start\", \"what\": \"help\", \"secs\": ${secs}"
+
+########################################
+# Against the mock server
+########################################
+"${MOCK}" -e "${ENDPOINT}" -d 0 -m 0 > "${TMP_DIR}/mock.log" 2>&1 &
+MOCK_PID=$!
+
+for ((i = 0; i < 50; i++)); do
+    grep -q "Serving" "${TMP_DIR}/mock.log" 2>/dev/null && break
+    sleep 0.1
+done
+if ! grep -q "Serving" "${TMP_DIR}/mock.log" 2>/dev/null; then
+    echo "$0: mock server did not start:" >&2
+    cat "${TMP_DIR}/mock.log" >&2
+    exit 1
+fi
+
+CLIENT_ARGS="-e ${ENDPOINT} -d 0 -m 0"
+
+# Connection, one get and exit
+secs=$(best_time "${CLIENT}" ${CLIENT_ARGS} --getkx)
+emit "\"bench\": \"cold_start\", \"what\": \"single_get\", \"secs\": ${secs}"
+
+# End-to-end full acquisition
+for chan in ${CHAN_LIST}; do
+    for samples in ${SAMPLES_LIST}; do
+        for filefmt in 0 1; do
+            secs=$(best_time "${CLIENT}" ${CLIENT_ARGS} -H ${chan} --setsamplespre ${samples} \
+                --setsamplespost 0 --setnumshots 1 --fullacq --filefmt ${filefmt})
+            emit "\"bench\": \"fullacq\", \"chan\": ${chan}, \"samples\": ${samples}, \"filefmt\": ${filefmt}, \"secs\": ${secs}"
+        done
+    done
+done
+
+# call_list execution rate, serial and --pipeline
+for calls in ${CALLS_LIST}; do
+    args=
+    for ((i = 0; i < calls; i++)); do
+        case $((i % 4)) in
+            0) args="${args} --getkx" ;;
+            1) args="${args} --setky 10000000" ;;
+            2) args="${args} -w" ;;
+            3) args="${args} --getky" ;;
+        esac
+    done
+
+    for mode in serial pipeline; do
+        extra=
+        [ ${mode} = pipeline ] && extra=--pipeline
+        secs=$(best_time "${CLIENT}" ${CLIENT_ARGS} ${extra} ${args})
+        rate=$(awk "BEGIN { if (\"${secs}\" == \"null\") print \"null\"; else printf \"%.1f\", ${calls}/${secs} }")
+        emit "\"bench\": \"call_list\", \"mode\": \"${mode}\", \"calls\": ${calls}, \"secs\": ${secs}, \"calls_per_s\": ${rate}"
+    done
+done
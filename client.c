@@ -1,9 +1,28 @@
+#include <errno.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 #include <acq_client.h>
 #include <halcs_client.h>
 
+#include "acq_buf.h"
+#include "acq_container.h"
+#include "acq_metadata.h"
+#include "acq_stream.h"
+#include "acq_wait.h"
+#include "client_lib.h"
+#include "client_stats.h"
+#include "curve_deint.h"
+#include "curve_fmt.h"
+#include "curve_fold.h"
+#include "curve_pos.h"
+#include "curve_reduce.h"
+#include "curve_spectrum.h"
+#include "curve_tune.h"
+
 #define DFLT_BIND_FOLDER "/tmp/bpm"
 
 #define DEFAULT_NUM_SAMPLES         4096
@@ -28,61 +47,162 @@
 /* Arbitrary hard limits */
 #define MAX_NUM_SAMPLES             (1 << 28)
 #define MAX_NUM_CHANS               (1 << 8)
+#define MAX_NUM_BOARDS              64
+#define MAX_NUM_BPMS                16
+
+/* Services of a call_list executed concurrently by --pipeline, and
+ * functions per service */
+#define PIPELINE_MAX_LANES          16
+#define MAX_CALL_LIST_ITEMS         256
 
-#define PRINTV(verbose, fmt, ...)\
+/* Default number of concurrent targets: a whole crate */
+#define FANOUT_DFLT_NUM_JOBS        24
+
+/* Verbose messages go to the output of the session, which is the output
+ * file of its target when fanning out */
+#define PRINTV(fp, verbose, fmt, ...)\
     do {\
         if (verbose) {\
-            printf (fmt, ## __VA_ARGS__);\
+            fprintf (fp, fmt, ## __VA_ARGS__);\
         }\
     }while(0)
 
 typedef enum {
     TEXT = 0,
     BINARY,
+    /* Binary payload in an acq_container record */
+    CONTAINER,
+    /* Binary, one column of consecutive samples per lane */
+    COLUMNS,
     END_FILE_FMT
 } filefmt_e;
 
-void print_data_curve (uint32_t chan, uint32_t *data, uint32_t size, filefmt_e filefmt)
+/* Summary written instead of the curve samples */
+typedef enum {
+    REDUCE_NONE = 0,
+    /* Count, mean, standard deviation, RMS, minimum and maximum per lane */
+    REDUCE_STATS,
+    END_REDUCE
+} reduce_e;
+
+static const char *reduce_names [END_REDUCE] = {
+    [REDUCE_NONE] = "none",
+    [REDUCE_STATS] = "stats"
+};
+
+/* Unit of the --position x and y */
+typedef enum {
+    POS_UNIT_NM = 0,
+    POS_UNIT_MM,
+    END_POS_UNIT
+} pos_unit_e;
+
+static const char *pos_unit_names [END_POS_UNIT] = {
+    [POS_UNIT_NM] = "nm",
+    [POS_UNIT_MM] = "mm"
+};
+
+/* Kx and Ky are set in nm */
+static const double pos_unit_nm [END_POS_UNIT] = {
+    [POS_UNIT_NM] = 1.0,
+    [POS_UNIT_MM] = 1e6
+};
+
+/* Rows of positions computed and written at a time: 128 KiB of doubles */
+#define POS_ROWS_PER_CHUNK          4096
+
+/* Rows written between two interruption checks. Large enough to keep all
+ * the threads of the formatting pool busy */
+#define PRINT_ROWS_PER_CHECK        (1 << 20)
+
+/* De-interleave rows of 4 lanes of lane_size bytes and write the 4 columns */
+static int _print_data_columns (curve_fmt_out_t *out, uint32_t *data, uint32_t size,
+        size_t lane_size)
+{
+    size_t rows = size/(4*lane_size);
+    void *columns = malloc (rows*4*lane_size);
+    if (columns == NULL) {
+        fprintf (stderr, "[client:acq]: Error in memory allocation for the columns\n");
+        return -1;
+    }
+
+    if (lane_size == sizeof (int16_t)) {
+        curve_deint_i16x4 (columns, (const int16_t *) data, rows);
+    } else {
+        curve_deint_i32x4 (columns, (const int32_t *) data, rows);
+    }
+    int err = curve_fmt_write (out, columns, rows*4*lane_size);
+    free (columns);
+    return err;
+}
+
+int print_data_curve (curve_fmt_out_t *out, uint32_t chan, uint32_t *data, uint32_t size,
+        filefmt_e filefmt)
 {
+    int err = 0;
+    int64_t start = client_stats_now ();
+
     /* FIXME: Make it more generic */
     if (chan == 0 || chan == 1 /* Only ADC and ADC SWAP */ ) {
         int16_t *raw_data16 = (int16_t *) data;
         if (filefmt == TEXT) {
-            for (uint32_t i = 0; i < (size/sizeof(uint16_t)) / 4; i++) {
+            uint32_t rows = (size/sizeof(uint16_t)) / 4;
+            for (uint32_t i = 0; i < rows && err == 0; i += PRINT_ROWS_PER_CHECK) {
                 if (zctx_interrupted) {
                     break;
                 }
 
-                printf ("%8d\t %8d\t %8d\t %8d\n",
-                        raw_data16[(i*4)],
-                        raw_data16[(i*4)+1],
-                        raw_data16[(i*4)+2],
-                        raw_data16[(i*4)+3]);
+                uint32_t chunk = (rows - i < PRINT_ROWS_PER_CHECK) ? rows - i : PRINT_ROWS_PER_CHECK;
+                err = curve_fmt_text_i16x4 (out, raw_data16 + i*4, chunk);
             }
         }
-        else if (filefmt == BINARY) {
-            fwrite (raw_data16, 2, size/2, stdout);
+        else if (filefmt == BINARY || filefmt == CONTAINER) {
+            err = curve_fmt_write (out, raw_data16, (size/2)*2);
+        }
+        else if (filefmt == COLUMNS) {
+            err = _print_data_columns (out, data, size, sizeof (int16_t));
         }
     }
     else {
         int32_t *raw_data32 = (int32_t *) data;
         if (filefmt == TEXT) {
-            for (uint32_t i = 0; i < (size/sizeof(uint32_t)) / 4; i++) {
+            uint32_t rows = (size/sizeof(uint32_t)) / 4;
+            for (uint32_t i = 0; i < rows && err == 0; i += PRINT_ROWS_PER_CHECK) {
                 if (zctx_interrupted) {
                     break;
                 }
 
-                printf ("%8d\t %8d\t %8d\t %8d\n",
-                        raw_data32[(i*4)],
-                        raw_data32[(i*4)+1],
-                        raw_data32[(i*4)+2],
-                        raw_data32[(i*4)+3]);
+                uint32_t chunk = (rows - i < PRINT_ROWS_PER_CHECK) ? rows - i : PRINT_ROWS_PER_CHECK;
+                err = curve_fmt_text_i32x4 (out, raw_data32 + i*4, chunk);
             }
         }
-        else if (filefmt == BINARY) {
-            fwrite (raw_data32, 4, size/4, stdout);
+        else if (filefmt == BINARY || filefmt == CONTAINER) {
+            err = curve_fmt_write (out, raw_data32, (size/4)*4);
+        }
+        else if (filefmt == COLUMNS) {
+            err = _print_data_columns (out, data, size, sizeof (int32_t));
         }
     }
+
+    if (curve_fmt_flush (out) < 0) {
+        err = -1;
+    }
+    client_stats_record (STATS_OUTPUT, start, size);
+    return err;
+}
+
+typedef struct {
+    curve_fmt_out_t *out;
+    uint32_t chan;
+    filefmt_e filefmt;
+} print_block_ctx_t;
+
+/* acq_stream sink: output each block as soon as it arrives. Blocks always
+ * hold whole samples, so rows are never split between two calls */
+static int _print_data_block (void *ctx, uint32_t *data, uint32_t size)
+{
+    print_block_ctx_t *print_ctx = (print_block_ctx_t *) ctx;
+    return print_data_curve (print_ctx->out, print_ctx->chan, data, size, print_ctx->filefmt);
 }
 
 typedef struct _call_var_t {
@@ -92,6 +212,8 @@ typedef struct _call_var_t {
     int poll;
     uint32_t write_val[MAX_VARIABLES_NUMBER];
     uint32_t read_val[MAX_VARIABLES_NUMBER];
+    /* Result of the last execution */
+    halcs_client_err_e err;
 } call_var_t;
 
 typedef call_var_t call_func_t;
@@ -112,7 +234,8 @@ void append_item (zlist_t* list, call_func_t func)
     zlist_freefn (list, wrap_func, _zlist_free_item, false);
 }
 
-int print_var (call_var_t *var)
+/* Format the value read by var, without a newline */
+int snprint_var (char *buf, size_t size, call_var_t *var)
 {
     const disp_op_t* func_structure = halcs_func_translate (var->name);
 
@@ -120,42 +243,45 @@ int print_var (call_var_t *var)
     {
         case DISP_ATYPE_UINT16:;
             uint16_t* read_val_ptr16 = (uint16_t *)var->read_val; /* Avoid strict-aliasing breaking */
-            printf ("%" PRIu16 "\n", *(read_val_ptr16));
-            break;
+            return snprintf (buf, size, "%" PRIu16, *(read_val_ptr16));
 
         case DISP_ATYPE_UINT32:;
             uint32_t* read_val_ptr32 = (uint32_t *)var->read_val; /* Avoid strict-aliasing breaking */
-            printf ("%" PRIu32 "\n", *(read_val_ptr32));
-            break;
+            return snprintf (buf, size, "%" PRIu32, *(read_val_ptr32));
 
         case DISP_ATYPE_UINT64:;
             uint64_t* read_val_ptr64 = (uint64_t *)var->read_val; /* Avoid strict-aliasing breaking */
-            printf ("%" PRIu64 "\n", *(read_val_ptr64));
-            break;
+            return snprintf (buf, size, "%" PRIu64, *(read_val_ptr64));
 
         case DISP_ATYPE_DOUBLE:;
             double* read_val_ptr_dbl = (double *)var->read_val;
-            printf ("%f\n", *(read_val_ptr_dbl));
-            break;
+            return snprintf (buf, size, "%f", *(read_val_ptr_dbl));
 
         default:
-            printf ("%" PRIu16 "\n", ((uint16_t )*(var->read_val)));
+            return snprintf (buf, size, "%" PRIu16, ((uint16_t )*(var->read_val)));
     }
+}
+
+int print_var (FILE *fp, call_var_t *var)
+{
+    char value[64];
+    snprint_var (value, sizeof (value), var);
+    fprintf (fp, "%s\n", value);
     return 0;
 }
 
-int print_var_v(int verbose, call_var_t *func)
+int print_var_v(FILE *fp, int verbose, call_var_t *func)
 {
-    PRINTV(verbose, "%s: ", func->name);
     if (verbose) {
-        print_var(func);
+        fprintf (fp, "%s: ", func->name);
+        print_var(fp, func);
     }
     return 0;
 }
 
-int print_func_v(int verbose, call_func_t *func)
+int print_func_v(FILE *fp, int verbose, call_func_t *func)
 {
-    return print_var_v(verbose, (call_var_t *)func);
+    return print_var_v(fp, verbose, (call_var_t *)func);
 }
 
 enum
@@ -220,7 +346,8 @@ inv_function:
     return err;
 }
 
-void print_usage (const char *program_name, FILE* stream, int exit_code)
+/* Write the usage information to stream */
+static void write_usage (const char *program_name, FILE* stream)
 {
     /* FIXME: Add the RFFE module functions' help information */
     fprintf (stream, "HALCS Client program\n");
@@ -229,8 +356,34 @@ void print_usage (const char *program_name, FILE* stream, int exit_code)
             "  -h  --help                       Display this usage information.\n"
             "  -v  --verbose                    Print verbose messages.\n"
             "  -e  --endpoint <endpoint>        Define broker endpoint\n"
-            "  -d  --board <number>             Define the target AFC board\n"
-            "  -m  --bpm <0 | 1>                Define the target FMC board\n"
+            "  -d  --board <list>               Define the target AFC boards\n"
+            "                                     [<list> is a number, a range or a comma separated\n"
+            "                                     list of both, e.g. 3 or 0-11 or 1,4-6]\n"
+            "  -m  --bpm <list>                 Define the target FMC boards (0, 1 or 0,1)\n"
+            "                                    When more than one board/bpm is given, all targets run\n"
+            "                                    concurrently and the output of each one is enclosed by a\n"
+            "                                    \"#target:<board>:<bpm>\" header and a\n"
+            "                                    \"#target:<board>:<bpm> ok|failed\" trailer\n"
+            "  --jobs <number>                  Maximum number of targets handled concurrently\n"
+            "                                     [Default is 24]\n"
+            "  --fmtthreads <number>            Number of threads formatting text curves, shared by\n"
+            "                                    the concurrent targets\n"
+            "                                     [Default is the number of online CPUs]\n"
+            "  --pipeline                       Execute the get/set functions of different modules\n"
+            "                                    concurrently, keeping their order within each module.\n"
+            "                                    All functions are executed even if some fail, results\n"
+            "                                    are printed in command line order and errors at the end\n"
+            "  --monitor <rate [Hz]>            Keep reading the get functions (e.g. -x -y -q -s -j) at a\n"
+            "                                    fixed rate. Each record holds the CLOCK_REALTIME timestamp\n"
+            "                                    [ns] and the values read. Set functions are executed once\n"
+            "                                    before the first record. A summary with the achieved rate\n"
+            "                                    and the number of missed deadlines is printed at the end\n"
+            "  --monitorcount <number>          Number of --monitor records [Default is 0, no limit]\n"
+            "  --monitorfile <file>             Write the --monitor records to file instead of stdout\n"
+            "  --stats[=text|json]              Time the broker connection, every remote call and the\n"
+            "                                    output, and print the count, p50/p99/max latency and\n"
+            "                                    throughput of each phase to stderr at exit\n"
+            "                                     [Default format is text]\n"
             "  -l  --leds <value>               Set board leds\n"
             "                                    [value must be between 0 and 7 (3 bits),\n"
             "                                     each bit sets one rgb led color\n"
@@ -354,7 +507,13 @@ void print_usage (const char *program_name, FILE* stream, int exit_code)
             "                                     ??? (TBD)]\n"
             "  --setnumshots      <number of shots>\n"
             "                                     [<number of shots> must be between greater than 1]\n"
-            "  -H  --setchan      <channel>     Sets FPGA Acquisition channel\n"
+            "  -H  --setchan      <list>        Sets FPGA Acquisition channel\n"
+            "                                    [<list> as in --board. With more than one channel,\n"
+            "                                     --fullacq acquires every channel in turn for each\n"
+            "                                     capture, transferring one while writing the previous\n"
+            "                                     one. Curves are preceded by a\n"
+            "                                     \"#capture:<n>:<chan> <timestamp [ns]> <bytes>\" line,\n"
+            "                                     or are container records keyed by channel]\n"
             "                                     [<channel> must be one of the following:\n"
             "                                     0 -> ADC; 1 -> ADC_SWAP; 2 -> Mixer IQ120; 3 -> Mixer IQ340;\n"
             "                                     4 -> TBT Decim IQ120; 5 -> TBT Decim IQ340; 6 -> TBT Amp;\n"
@@ -370,16 +529,109 @@ void print_usage (const char *program_name, FILE* stream, int exit_code)
             "  -A  --getblock <block number>    Get specified data block from server \n"
             "  --getcurve                       Get a whole data curve \n"
             "  --fullacq                        Perform a full acquisition\n"
+            "  --stream                         Retrieve --getcurve/--fullacq data block by block,\n"
+            "                                    writing each block while the next one is transferred\n"
+            "  --streambufs <number of buffers> Sets the number of block buffers used by --stream\n"
+            "                                     [<number of buffers> must be between 2 and 64. Default is 4]\n"
+            "  --pershot                        Stream --getcurve/--fullacq data shot by shot, writing each\n"
+            "                                    shot as soon as its blocks arrive, after a\n"
+            "                                    \"#shot:<n> <timestamp [ns]> <bytes>\" line or as a\n"
+            "                                    container record of its own (Implies --stream). The\n"
+            "                                    transfer still starts once every shot is acquired, as\n"
+            "                                    the server does not report the end of a single shot\n"
+            "  --hugepages                      Back the curve buffers with explicit huge pages, if the\n"
+            "                                    system has them reserved\n"
+            "  --mlock                          Lock the curve buffers in memory\n"
+            "  --loop <number of captures | inf>\n"
+            "                                   Repeat --fullacq, starting each acquisition as soon as the\n"
+            "                                    previous curve is transferred and writing that curve while\n"
+            "                                    the board acquires. Each capture is preceded by a\n"
+            "                                    \"#capture:<n> <timestamp [ns]> <bytes>\" line and the dead\n"
+            "                                    time of each cycle is printed to stderr\n"
             "  --filefmt <Acquisition file format>\n"
             "                                   Sets the acquisition file format\n"
             "                                     [<Acquisition file format>\n"
             "                                     Must be between one of the following:\n"
-            "                                     <0 = text mode | 1 = binary mode>]\n"
+            "                                     <0 = text mode | 1 = binary mode |\n"
+            "                                      2 = binary container: header with the board, channel,\n"
+            "                                      layout and timestamps, page aligned raw samples and\n"
+            "                                      a shot index (see acq_container.h) |\n"
+            "                                      3 = binary columns: the samples of lane A, then those\n"
+            "                                      of lanes B, C and D, each one contiguous>]\n"
+            "  --reduce <stats>                 Write a summary of each curve instead of its samples.\n"
+            "                                    stats: a \"#lane count mean std rms min max\" line and\n"
+            "                                    one such line per lane (A to D), with the population\n"
+            "                                    standard deviation\n"
+            "  --position[=nm|mm]               Write the beam position of amplitude curves (--setchan\n"
+            "                                    6, 11 or 14) instead of their samples: x, y, q and sum\n"
+            "                                    per sample, from the delta over sigma of the 4 lanes and\n"
+            "                                    the Kx, Ky and Ksum read back from the board before the\n"
+            "                                    acquisition. Text rows hold \"x y q sum\" and binary rows\n"
+            "                                    (--filefmt 1) 4 doubles\n"
+            "                                     [Default unit of x and y is nm]\n"
+            "  --spectrum                       Write the spectral figures of ADC curves (--setchan 0 or 1)\n"
+            "                                    instead of their samples: a \"#spectrum <fft size>\n"
+            "                                    <sample rate [Hz]>\" line, a \"#lane carrier_hz\n"
+            "                                    carrier_dbfs snr_db sfdr_dbc thd_dbc sinad_db enob\" line\n"
+            "                                    and one such line per lane (A to D). Each lane is\n"
+            "                                    windowed with a Blackman-Harris window. The sample rate\n"
+            "                                    is --acqrate or, with --metadata, the ADC clock of the\n"
+            "                                    template (signal_carrier_frequency /\n"
+            "                                    signal_carrier_harmonic_number *\n"
+            "                                    adc_clock_sampling_harmonic) or else the nominal one\n"
+            "  --tune                           Write the fractional betatron tunes of TBT position\n"
+            "                                    curves (--setchan 8) instead of their samples: a\n"
+            "                                    \"#tune <turns>\" line, a \"#plane tune amplitude phase\n"
+            "                                    confidence\" line and one such line per plane (X and Y).\n"
+            "                                    The phase [rad] is that of a cosine at the first turn and\n"
+            "                                    the confidence (0 to 1) is the fraction of the position\n"
+            "                                    variance explained by the tune line\n"
+            "  --swsweep <first>:<last>[:<step>]\n"
+            "                                   Sweep the SW delay (--setswdly) from first to last in steps\n"
+            "                                    of step (Default is 1), with a --fullacq of an ADC channel\n"
+            "                                    (--setchan 0 or 1) per delay. Each curve is folded over the\n"
+            "                                    switching period (twice the --setdivclk divider) while the\n"
+            "                                    next one is acquired, giving a \"<delay> <lane>\n"
+            "                                    <state0_rms> <state1_rms> <ripple>\" line per lane, where\n"
+            "                                    the ripple is the peak to peak of the RMS over the period\n"
+            "                                    relative to its mean. The delay with the least mean ripple\n"
+            "                                    is written in a \"#swdly_optimal <delay> <ripple>\" line\n"
+            "                                    and left set on the board. A sweep that does not finish\n"
+            "                                    restores the SW delay it started from\n"
+            "  --hash <md5 | sha1 | sha256>     Compute the digest of the curve output as it is written\n"
+            "                                    and print \"[client:hash]: <board>:<bpm> <algorithm>\n"
+            "                                    <digest> <bytes>\" to stderr when the command ends\n"
+            "  --hashfile <file>                Append \"<board>:<bpm> <algorithm> <digest> <bytes>\" to\n"
+            "                                    file instead\n"
+            "  --metadata <template>            Write a metadata sidecar from template (see\n"
+            "                                    scripts/metadata_templates) when the command ends. It adds\n"
+            "                                    the acquisition start and completion timestamps, the\n"
+            "                                    acquisition parameters, the file format and the data\n"
+            "                                    signature. The signature uses the --hash algorithm or, if\n"
+            "                                    not given, the template data_signature_method\n"
+            "  --metadatafile <file>            Metadata sidecar file. It may be the template itself\n"
             "  --timeout    <timeout [ms]>      Sets the timeout for the polling function\n"
+            "  --acqrate <rate [Hz]>            Sample rate of the acquisition channel. Waiting for the end\n"
+            "                                    of an acquisition sleeps through most of its expected\n"
+            "                                    duration and then checks with a growing interval\n"
+            "                                     [Default is the nominal rate of the channel]\n"
+            "  --batch <file | ->               Execute the commands in file (or stdin, for -), one per line,\n"
+            "                                    over a single broker connection. Lines take the same options\n"
+            "                                    as the command line and each one is followed by a\n"
+            "                                    \"#batch:<line> ok|failed\" record. Only -e, -d, -m, -v\n"
+            "                                    and --stats may be given along with it\n"
             );
+}
+
+void print_usage (const char *program_name, FILE* stream, int exit_code)
+{
+    write_usage (program_name, stream);
     exit (exit_code);
 }
 
+/* Maximum number of arguments in a --batch line */
+#define BATCH_MAX_ARGS              256
+
 /* Long-only options */
 enum {
     pllstatus = 1000,
@@ -461,7 +713,31 @@ enum {
     getcurve,
     fullacq,
     timeout,
-    filefmt
+    filefmt,
+    stream,
+    streambufs,
+    pershot,
+    hugepages,
+    mlockbufs,
+    batch,
+    jobs,
+    fmtthreads,
+    pipeline,
+    monitor,
+    monitorcount,
+    monitorfile,
+    stats,
+    loop,
+    hash,
+    hashfile,
+    metadata,
+    metadatafile,
+    acqrate,
+    reduce,
+    position,
+    spectrum,
+    tune,
+    swsweep
 };
 
 /* TODO: Check which 'set' functions are boolean and set them without the need of an entry value */
@@ -588,82 +864,231 @@ static struct option long_options[] =
     {"fullacq",             no_argument,         NULL, fullacq},
     {"timeout",             required_argument,   NULL, timeout},
     {"filefmt",             required_argument,   NULL, filefmt},
+    {"stream",              no_argument,         NULL, stream},
+    {"streambufs",          required_argument,   NULL, streambufs},
+    {"pershot",             no_argument,         NULL, pershot},
+    {"hugepages",           no_argument,         NULL, hugepages},
+    {"mlock",               no_argument,         NULL, mlockbufs},
+    {"batch",               required_argument,   NULL, batch},
+    {"jobs",                required_argument,   NULL, jobs},
+    {"fmtthreads",          required_argument,   NULL, fmtthreads},
+    {"pipeline",            no_argument,         NULL, pipeline},
+    {"monitor",             required_argument,   NULL, monitor},
+    {"monitorcount",        required_argument,   NULL, monitorcount},
+    {"monitorfile",         required_argument,   NULL, monitorfile},
+    {"stats",               optional_argument,   NULL, stats},
+    {"loop",                required_argument,   NULL, loop},
+    {"hash",                required_argument,   NULL, hash},
+    {"hashfile",            required_argument,   NULL, hashfile},
+    {"reduce",              required_argument,   NULL, reduce},
+    {"position",            optional_argument,   NULL, position},
+    {"spectrum",            no_argument,         NULL, spectrum},
+    {"tune",                no_argument,         NULL, tune},
+    {"swsweep",             required_argument,   NULL, swsweep},
+    {"metadata",            required_argument,   NULL, metadata},
+    {"metadatafile",        required_argument,   NULL, metadatafile},
+    {"acqrate",             required_argument,   NULL, acqrate},
     {NULL, 0, NULL, 0}
 };
 
-int main (int argc, char *argv [])
-{
-    int ch;
-    int verbose = 0;
-    char *broker_endp = NULL;
-    char *default_broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
-    const char* program_name;
-    program_name = argv[0];
-
-    uint32_t bpm_number;
+/* Options of a single command: the program command line or one line of
+ * a --batch file */
+typedef struct {
+    int verbose;
+    char *broker_endp;
+    char *board_number_str;
+    char *bpm_number_str;
+    char *filefmt_str;
+    char *batch_file;
+    /* Number of options other than the ones --batch takes along with it */
+    uint32_t num_cmd_opts;
     uint32_t board_number;
-    char *board_number_str = NULL;
-    char *bpm_number_str = NULL;
-    char *filefmt_str = NULL;
-    int filefmt_val = 0;
+    uint32_t bpm_number;
+    uint32_t board_list[MAX_NUM_BOARDS];
+    uint32_t num_boards;
+    uint32_t bpm_list[MAX_NUM_BPMS];
+    uint32_t num_bpms;
+    uint32_t num_jobs;
+    /* Text formatting threads, 0 for one per online CPU */
+    uint32_t fmt_threads;
+    int filefmt_val;
+    zlist_t *call_list;
 
     /* Acquitision parameters check variables */
-    int acq_chan_set = 0;
-    uint32_t acq_samples_pre_val = 10;
-    uint32_t acq_samples_post_val = 0;
-    uint32_t acq_num_shots_val = 1;
-    uint32_t acq_total_samples_val = 0;
-    uint32_t acq_chan_val = 0;
-    int acq_full_call = 0;
-    int acq_start_call = 0;
-    int acq_check_call = 0;
-    int acq_get_block = 0;
-    int acq_get_curve_call = 0;
-    uint32_t acq_block_id = 0;
-    int check_poll = 0;
-    int poll_timeout = -1;
+    int acq_chan_set;
+    /* -H list: every channel is acquired, in order, for each capture */
+    char *acq_chan_str;
+    uint32_t acq_chan_list[END_CHAN_ID];
+    uint32_t num_acq_chans;
+    uint32_t acq_samples_pre_val;
+    uint32_t acq_samples_post_val;
+    uint32_t acq_num_shots_val;
+    uint32_t acq_total_samples_val;
+    uint32_t acq_chan_val;
+    int acq_full_call;
+    int acq_start_call;
+    int acq_check_call;
+    int acq_get_block;
+    int acq_get_curve_call;
+    uint32_t acq_block_id;
+    int check_poll;
+    int poll_timeout;
+    int acq_stream_call;
+    uint32_t acq_stream_bufs;
+    /* Write every shot of a streamed curve as a record of its own */
+    int acq_pershot_call;
+    /* ACQ_BUF_* flags of the curve buffers */
+    int acq_buf_flags;
+    int pipeline_call;
+    /* Sample rate of the acquisition channel [Hz], 0 for the nominal one */
+    double acq_rate;
+    /* Repeated --fullacq: number of captures, 0 for no limit */
+    int acq_loop_call;
+    uint64_t acq_loop_count;
+
+    /* Monitoring mode: rate [Hz], number of samples (0 for no limit) and
+     * output file (NULL for the command output) */
+    double monitor_rate;
+    uint64_t monitor_count;
+    char *monitor_file;
+
+    /* Timing statistics, printed to stderr at exit */
+    int stats_call;
+    stats_fmt_e stats_fmt;
+
+    /* Digest of the curve output, printed to stderr or appended to
+     * hash_file */
+    curve_hash_alg_e hash_alg;
+    char *hash_file;
+    /* Summary written instead of the curves */
+    reduce_e reduce;
+    /* Beam position written instead of the amplitude curves */
+    int position_call;
+    pos_unit_e position_unit;
+    /* Spectral figures written instead of the ADC curves */
+    int spectrum_call;
+    /* Betatron tunes written instead of the TBT position curves */
+    int tune_call;
+    /* SW delay sweep: one capture per delay, from first to last */
+    int sw_sweep_call;
+    uint32_t sw_sweep_first;
+    uint32_t sw_sweep_last;
+    uint32_t sw_sweep_step;
+
+    /* Metadata sidecar, written from a template after the acquisition */
+    char *metadata_template;
+    char *metadata_file;
+} client_cmd_t;
+
+/* Broker connections, kept open across the commands of a batch, and the
+ * output state of the commands */
+typedef struct {
+    /* Addressed to the board/bpm of the current command */
+    client_lib_session_t *lib;
+    /* Command output. Curves go through curve_out, which writes to the
+     * same file */
+    FILE *out_fp;
+    curve_fmt_out_t curve_out;
+    /* CLOCK_REALTIME [ns] of the start and of the completion of the
+     * acquisition of the current command, 0 if unknown */
+    int64_t acq_start_ns;
+    int64_t acq_end_ns;
+    /* Curve buffers, recycled across the commands of a batch */
+    acq_buf_pool_t buf_pool;
+    /* --position gains, read back from the board by the current command */
+    curve_pos_gains_t pos_gains;
+    /* --spectrum FFT plan, kept while the curve size does not change, and
+     * sample rate of the current command [Hz] */
+    curve_spectrum_plan_t spectrum_plan;
+    double spectrum_rate;
+    /* --tune plan, kept while the number of turns does not change */
+    curve_tune_plan_t tune_plan;
+    /* Text formatting threads of curve_out */
+    curve_fmt_pool_t fmt_pool;
+    /* Extra connections of the --pipeline service lanes. Lane 0 uses lib */
+    client_lib_session_t *lane_sessions[PIPELINE_MAX_LANES];
+} client_session_t;
+
+static void client_cmd_init (client_cmd_t *cmd)
+{
+    memset (cmd, 0, sizeof (*cmd));
+    cmd->acq_samples_pre_val = 10;
+    cmd->acq_num_shots_val = 1;
+    cmd->poll_timeout = -1;
+    cmd->acq_stream_bufs = ACQ_STREAM_DFLT_NUM_BUFS;
+    cmd->num_jobs = FANOUT_DFLT_NUM_JOBS;
+
+    cmd->call_list = zlist_new();
+    if (cmd->call_list == NULL) {
+        fprintf(stderr, "[client]: Error in memory allocation for zlist\n");
+    }
+}
 
+static void client_cmd_destroy (client_cmd_t *cmd)
+{
+    zlist_destroy (&cmd->call_list);
+    free (cmd->batch_file);
+    free (cmd->monitor_file);
+    free (cmd->hash_file);
+    free (cmd->metadata_template);
+    free (cmd->metadata_file);
+    free (cmd->filefmt_str);
+    free (cmd->acq_chan_str);
+    free (cmd->broker_endp);
+    free (cmd->board_number_str);
+    free (cmd->bpm_number_str);
+}
 
-    const char* shortopt = "hve:d:m:l:pP:Lc:u:U:V:nN:oO:i:D:a:b:r:R:B:M:u:U:k:j:xyqswW:tT:zZ:fF:H:IKA:";
+/* client_cmd_parse return value when help was asked for */
+#define CLIENT_CMD_HELP             1
 
-    zlist_t *call_list = zlist_new();
-    if (call_list == NULL) {
-        fprintf(stderr, "[client]: Error in memory allocation for zlist\n");
-    }
+/* Fill cmd from a command line. Returns 0 on success, CLIENT_CMD_HELP on -h
+ * and -1 on a bad option */
+static int client_cmd_parse (client_cmd_t *cmd, const char *program_name, int argc, char *argv [])
+{
+    int ch;
+    const char* shortopt = "hve:d:m:l:pP:Lc:u:U:V:nN:oO:i:D:a:b:r:R:B:M:u:U:k:j:xyqswW:tT:zZ:fF:H:IKA:";
 
     char corr_name[50];
-    call_func_t item = {0,0,0,0,{0},{0}};
+    call_func_t item = {0,0,0,0,{0},{0},HALCS_CLIENT_SUCCESS};
+
+    /* Fully reinitialize getopt, as it runs once per batch command */
+    optind = 0;
 
     while ((ch = getopt_long_only(argc, argv, shortopt , long_options, NULL)) != -1)
     {
         double db_val = 0;
         halcs_client_err_e err = HALCS_CLIENT_SUCCESS;
 
+        if (ch != 'v' && ch != 'e' && ch != 'd' && ch != 'm' && ch != stats && ch != batch) {
+            cmd->num_cmd_opts++;
+        }
+
         /* Get the user selected options */
         switch (ch)
         {
                 /* Display Help */
             case 'h':
-                print_usage(program_name, stderr, 0);
+                return CLIENT_CMD_HELP;
 
                 /* Define Verbosity level */
             case 'v':
-                verbose = 1;
+                cmd->verbose = 1;
                 break;
 
                 /* Define Broker Endpoint */
             case 'e':
-                broker_endp = strdup(optarg);
+                cmd->broker_endp = strdup(optarg);
                 break;
 
                 /* Define Board Number */
             case 'd':
-                board_number_str = strdup(optarg);
+                cmd->board_number_str = strdup(optarg);
                 break;
 
                 /* Define BPM number */
             case 'm':
-                bpm_number_str = strdup(optarg);
+                cmd->bpm_number_str = strdup(optarg);
                 break;
 
                 /* Blink FMC Leds */
@@ -671,7 +1096,7 @@ int main (int argc, char *argv [])
                 item.name = FMC_ADC_COMMON_NAME_LEDS;
                 item.service = FMC_ADC_COMMON_MODULE_NAME;
                 *item.write_val = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get PLL Function */
@@ -680,7 +1105,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set PLL Function */
@@ -690,7 +1115,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get PLL Lock Status */
@@ -699,7 +1124,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* AD9510 Defaults */
@@ -707,7 +1132,7 @@ int main (int argc, char *argv [])
                 item.name = FMC_ACTIVE_CLK_NAME_AD9510_CFG_DEFAULTS;
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 0;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Clock Selection */
@@ -716,7 +1141,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Clock Selection */
@@ -726,7 +1151,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get ADC Rand */
@@ -735,7 +1160,7 @@ int main (int argc, char *argv [])
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set ADC Rand */
@@ -745,7 +1170,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get ADC DITH */
@@ -754,7 +1179,7 @@ int main (int argc, char *argv [])
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set ADC DITH */
@@ -764,7 +1189,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get ADC SHDN */
@@ -773,7 +1198,7 @@ int main (int argc, char *argv [])
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set ADC SHDN */
@@ -783,7 +1208,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get ADC PGA */
@@ -792,7 +1217,7 @@ int main (int argc, char *argv [])
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set ADC PGA */
@@ -802,20 +1227,20 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get ADC Data */
             case 'c':
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DATA0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -823,13 +1248,13 @@ int main (int argc, char *argv [])
             case 'C':
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DATA0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -837,13 +1262,13 @@ int main (int argc, char *argv [])
             case getdlyval:
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DLY_VAL0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -851,13 +1276,13 @@ int main (int argc, char *argv [])
             case setdlyval:
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DLY_VAL0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -865,13 +1290,13 @@ int main (int argc, char *argv [])
             case getdlyline:
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DLY_LINE0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -879,13 +1304,13 @@ int main (int argc, char *argv [])
             case setdlyline:
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DLY_LINE0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -893,13 +1318,13 @@ int main (int argc, char *argv [])
             case getdlyupdt:
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DLY_UPDT0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -907,13 +1332,13 @@ int main (int argc, char *argv [])
             case setdlyupdt:
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DLY_UPDT0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -921,13 +1346,13 @@ int main (int argc, char *argv [])
             case 'V':
                 if ((err = parse_subopt (optarg, mount_opts, FMC130M_4CH_NAME_ADC_DLY0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = FMC130M_4CH_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -938,7 +1363,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Test data on ADC */
@@ -947,7 +1372,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ADC_COMMON_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set SI571 OE */
@@ -957,7 +1382,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get SI571 OE */
@@ -966,7 +1391,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set SI571 Frequency */
@@ -977,7 +1402,7 @@ int main (int argc, char *argv [])
                 *item.write_val = item.rw;
                 db_val = strtod(optarg, NULL);
                 memcpy((item.write_val+4), &db_val, sizeof(double));
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get SI571 Defaults */
@@ -988,7 +1413,7 @@ int main (int argc, char *argv [])
                 *item.write_val = item.rw;
                 db_val = strtod(optarg, NULL);
                 memcpy(item.write_val+4, &db_val, sizeof(double));
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Trigger Dir */
@@ -998,7 +1423,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Trigger Dir */
@@ -1007,7 +1432,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ADC_COMMON_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Trigger Term */
@@ -1017,7 +1442,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Trigger Term */
@@ -1026,7 +1451,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ADC_COMMON_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Trigger Value */
@@ -1036,7 +1461,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Trigger Value */
@@ -1045,7 +1470,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ADC_COMMON_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 PLL A Divider */
@@ -1055,7 +1480,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 PLL A Divider */
@@ -1064,7 +1489,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 PLL B Divider */
@@ -1074,7 +1499,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 PLL B Divider */
@@ -1083,7 +1508,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 PLL Prescaler */
@@ -1093,7 +1518,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 PLL Prescaler */
@@ -1102,7 +1527,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 R Divider */
@@ -1112,7 +1537,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 R Divider */
@@ -1121,7 +1546,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 PLL PDown */
@@ -1131,7 +1556,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 PLL PDown */
@@ -1140,7 +1565,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 MUX Status */
@@ -1150,7 +1575,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 MUX Status */
@@ -1159,7 +1584,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 CP Current */
@@ -1169,7 +1594,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 CP Current */
@@ -1178,7 +1603,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 Outputs */
@@ -1188,7 +1613,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 Outputs */
@@ -1197,7 +1622,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set AD9510 PLL Clock Select */
@@ -1207,7 +1632,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                  /* Get AD9510 PLL Clock Select */
@@ -1216,7 +1641,7 @@ int main (int argc, char *argv [])
                 item.service = FMC_ACTIVE_CLK_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /****** DSP Functions ******/
@@ -1228,7 +1653,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Kx */
@@ -1237,7 +1662,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Ky */
@@ -1247,7 +1672,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Ky */
@@ -1256,7 +1681,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Ksum */
@@ -1266,7 +1691,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Ksum */
@@ -1275,7 +1700,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set TBT Thres */
@@ -1285,7 +1710,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get TBT Thres */
@@ -1294,7 +1719,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set FOFB Threshold */
@@ -1304,7 +1729,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get FOFB Threshold */
@@ -1313,7 +1738,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Monit Threshold */
@@ -1323,7 +1748,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Monit Threshold */
@@ -1332,7 +1757,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Monit Position X */
@@ -1342,7 +1767,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Monit Position X */
@@ -1351,7 +1776,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Monit Position Y */
@@ -1361,7 +1786,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Monit Position Y */
@@ -1370,7 +1795,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Monit Position Q */
@@ -1380,7 +1805,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Monit Position Q */
@@ -1389,7 +1814,7 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Monit Position SUM */
@@ -1399,7 +1824,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Monit Position SUM */
@@ -1408,20 +1833,20 @@ int main (int argc, char *argv [])
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Monit AMP */
             case 'J':
                 if ((err = parse_subopt (optarg, mount_opts, DSP_NAME_SET_GET_MONIT_AMP_CH0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = DSP_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1429,13 +1854,13 @@ int main (int argc, char *argv [])
             case 'j':
                 if ((err = parse_subopt (optarg, mount_opts, DSP_NAME_SET_GET_MONIT_AMP_CH0, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = DSP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1448,7 +1873,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get SW */
@@ -1457,7 +1882,7 @@ int main (int argc, char *argv [])
                 item.service = SWAP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set SW Delay */
@@ -1467,7 +1892,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get SW Delay */
@@ -1476,7 +1901,7 @@ int main (int argc, char *argv [])
                 item.service = SWAP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set Div Clock */
@@ -1486,7 +1911,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get Div Clock */
@@ -1495,7 +1920,7 @@ int main (int argc, char *argv [])
                 item.service = SWAP_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /******** RFFE Module Functions *******/
@@ -1504,13 +1929,13 @@ int main (int argc, char *argv [])
             case rffesetatt:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_ATT, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1518,13 +1943,13 @@ int main (int argc, char *argv [])
             case rffegetatt:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_ATT, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1532,13 +1957,13 @@ int main (int argc, char *argv [])
             case rffesettemp:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_TEMP_AC, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1546,13 +1971,13 @@ int main (int argc, char *argv [])
             case rffegettemp:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_TEMP_AC, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1560,13 +1985,13 @@ int main (int argc, char *argv [])
             case rffesetpnt:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_SET_POINT_AC, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1574,13 +1999,13 @@ int main (int argc, char *argv [])
             case rffegetpnt:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_SET_POINT_AC, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1591,7 +2016,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Get RFFE Temperature Control */
@@ -1600,20 +2025,20 @@ int main (int argc, char *argv [])
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* Set RFFE Output */
             case rffesetout:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_HEATER_AC, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 0;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1621,13 +2046,13 @@ int main (int argc, char *argv [])
             case rffegetout:
                 if ((err = parse_subopt (optarg, mount_opts, RFFE_NAME_SET_GET_HEATER_AC, corr_name, item.write_val)) != HALCS_CLIENT_SUCCESS) {
                     fprintf(stderr, "%s: %s - '%s'\n", program_name, halcs_client_err_str(err), corr_name);
-                    exit(EXIT_FAILURE);
+                    return -1;
                 }
                 item.name = strdup(corr_name);
                 item.service = RFFE_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 free(item.name);
                 break;
 
@@ -1638,7 +2063,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /* RFFE Reprogram */
@@ -1648,7 +2073,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /******** ACQ Module Functions ********/
@@ -1659,7 +2084,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case getacqtrig:
@@ -1667,7 +2092,7 @@ int main (int argc, char *argv [])
                 item.service = ACQ_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case setdatatrigchan:
@@ -1676,7 +2101,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case getdatatrigchan:
@@ -1684,7 +2109,7 @@ int main (int argc, char *argv [])
                 item.service = ACQ_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case setdatatrigpol:
@@ -1693,7 +2118,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case getdatatrigpol:
@@ -1701,7 +2126,7 @@ int main (int argc, char *argv [])
                 item.service = ACQ_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case setdatatrigsel:
@@ -1710,7 +2135,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case getdatatrigsel:
@@ -1718,7 +2143,7 @@ int main (int argc, char *argv [])
                 item.service = ACQ_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case setdatatrigfilt:
@@ -1727,7 +2152,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case getdatatrigfilt:
@@ -1735,7 +2160,7 @@ int main (int argc, char *argv [])
                 item.service = ACQ_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case setdatatrigthres:
@@ -1744,7 +2169,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtol(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case getdatatrigthres:
@@ -1752,7 +2177,7 @@ int main (int argc, char *argv [])
                 item.service = ACQ_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case settrigdly:
@@ -1761,7 +2186,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = strtoul(optarg, NULL, 10);
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case gettrigdly:
@@ -1769,7 +2194,7 @@ int main (int argc, char *argv [])
                 item.service = ACQ_MODULE_NAME;
                 item.rw = 1;
                 *item.write_val = item.rw;
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case genswtrig:
@@ -1778,7 +2203,7 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = 1; /* Generate trigger */
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
             case acqstop:
@@ -1787,290 +2212,2562 @@ int main (int argc, char *argv [])
                 item.rw = 0;
                 *item.write_val = item.rw;
                 *(item.write_val+4) = 1; /* Generate stop event */
-                append_item (call_list, item);
+                append_item (cmd->call_list, item);
                 break;
 
                 /*  Set Acq Pre-trigger Samples */
             case setsamplespre:
-                acq_samples_pre_val =  strtoul(optarg, NULL, 10);
+                cmd->acq_samples_pre_val =  strtoul(optarg, NULL, 10);
                 break;
 
             case setsamplespost:
-                acq_samples_post_val =  strtoul(optarg, NULL, 10);
+                cmd->acq_samples_post_val =  strtoul(optarg, NULL, 10);
                 break;
 
             case setnumshots:
-                acq_num_shots_val =  strtoul(optarg, NULL, 10);
+                cmd->acq_num_shots_val =  strtoul(optarg, NULL, 10);
                 break;
 
                 /*  Set Acq Chan */
             case 'H':
-                acq_chan_set = 1;
-                acq_chan_val =  strtoul(optarg, NULL, 10);
+                cmd->acq_chan_set = 1;
+                free(cmd->acq_chan_str);
+                cmd->acq_chan_str = strdup(optarg);
                 break;
 
                 /*  Set Acq Start */
             case 'I':
-                acq_start_call = 1;
+                cmd->acq_start_call = 1;
                 break;
 
                 /*  Check if the acquisition is finished */
             case 'K':
-                acq_check_call = 1;
-                check_poll = 0;
+                cmd->acq_check_call = 1;
+                cmd->check_poll = 0;
                 break;
 
                 /*  Check if the acquisition is finished until timeout (-1 for infinite) */
             case acqcheckpoll:
-                acq_check_call = 1;
-                check_poll = 1;
+                cmd->acq_check_call = 1;
+                cmd->check_poll = 1;
                 break;
 
                 /*  Get a single data block from the acquisition */
             case 'A':
-                acq_get_block = 1;
-                acq_block_id =  strtoul(optarg, NULL, 10);
+                cmd->acq_get_block = 1;
+                cmd->acq_block_id =  strtoul(optarg, NULL, 10);
                 break;
 
                 /*  Get a whole data curve */
             case getcurve:
-                acq_get_curve_call = 1;
+                cmd->acq_get_curve_call = 1;
                 break;
 
                 /*  Perform full acq */
             case fullacq:
-                acq_full_call = 1;
+                cmd->acq_full_call = 1;
                 break;
 
                 /*  Set Polling timeout */
             case timeout:
-                poll_timeout = (int) strtol(optarg, NULL, 10);
+                cmd->poll_timeout = (int) strtol(optarg, NULL, 10);
                 break;
 
                 /*  Set acquisition output format */
             case filefmt:
-                filefmt_str = strdup (optarg);
+                cmd->filefmt_str = strdup (optarg);
+                break;
+
+                /*  Retrieve curves block by block */
+            case stream:
+                cmd->acq_stream_call = 1;
+                break;
+
+                /*  Set number of stream block buffers */
+            case streambufs:
+                cmd->acq_stream_bufs = strtoul(optarg, NULL, 10);
+                break;
+
+                /*  Stream curves shot by shot */
+            case pershot:
+                cmd->acq_pershot_call = 1;
+                cmd->acq_stream_call = 1;
+                break;
+
+                /*  Curve buffer memory */
+            case hugepages:
+                cmd->acq_buf_flags |= ACQ_BUF_HUGETLB;
+                break;
+
+            case mlockbufs:
+                cmd->acq_buf_flags |= ACQ_BUF_MLOCK;
+                break;
+
+                /*  Execute commands from a file */
+            case batch:
+                cmd->batch_file = strdup(optarg);
+                break;
+
+                /*  Set number of concurrent targets */
+            case jobs:
+                cmd->num_jobs = strtoul(optarg, NULL, 10);
+                break;
+
+            case fmtthreads:
+                cmd->fmt_threads = strtoul(optarg, NULL, 10);
+                if (cmd->fmt_threads == 0) {
+                    fprintf(stderr, "%s: --fmtthreads must be greater than 0\n", program_name);
+                    return -1;
+                }
+                break;
+
+                /*  Execute independent services concurrently */
+            case pipeline:
+                cmd->pipeline_call = 1;
+                break;
+
+                /*  Poll the get functions at a fixed rate */
+            case monitor:
+                cmd->monitor_rate = strtod(optarg, NULL);
+                if (cmd->monitor_rate <= 0) {
+                    fprintf(stderr, "%s: The monitoring rate must be greater than 0\n", program_name);
+                    return -1;
+                }
+                break;
+
+            case monitorcount:
+                cmd->monitor_count = strtoull(optarg, NULL, 10);
+                break;
+
+            case monitorfile:
+                cmd->monitor_file = strdup(optarg);
+                break;
+
+                /*  Repeat the full acquisition */
+            case loop:
+                cmd->acq_loop_call = 1;
+                if (streq(optarg, "inf")) {
+                    cmd->acq_loop_count = 0;
+                } else {
+                    cmd->acq_loop_count = strtoull(optarg, NULL, 10);
+                    if (cmd->acq_loop_count == 0) {
+                        fprintf(stderr, "%s: The number of captures must be greater than 0 or inf\n", program_name);
+                        return -1;
+                    }
+                }
+                break;
+
+                /*  Time every phase and remote call */
+            case stats:
+                cmd->stats_call = 1;
+                if (optarg == NULL || streq(optarg, "text")) {
+                    cmd->stats_fmt = STATS_FMT_TEXT;
+                } else if (streq(optarg, "json")) {
+                    cmd->stats_fmt = STATS_FMT_JSON;
+                } else {
+                    fprintf(stderr, "%s: Invalid statistics format '%s'\n", program_name, optarg);
+                    return -1;
+                }
+                break;
+
+                /*  Digest of the curve output */
+            case hash:
+                cmd->hash_alg = curve_hash_alg_parse(optarg);
+                if (cmd->hash_alg == CURVE_HASH_NONE) {
+                    fprintf(stderr, "%s: Invalid hash algorithm '%s'\n", program_name, optarg);
+                    return -1;
+                }
+                break;
+
+            case hashfile:
+                cmd->hash_file = strdup(optarg);
+                break;
+
+                /*  Curve summary */
+            case reduce:
+                cmd->reduce = END_REDUCE;
+                for (int r = REDUCE_NONE+1; r < END_REDUCE; r++) {
+                    if (streq(optarg, reduce_names[r])) {
+                        cmd->reduce = r;
+                    }
+                }
+                if (cmd->reduce == END_REDUCE) {
+                    fprintf(stderr, "%s: Invalid reduction '%s'\n", program_name, optarg);
+                    return -1;
+                }
+                break;
+
+                /*  Beam position of amplitude curves */
+            case position:
+                cmd->position_call = 1;
+                if (optarg == NULL || streq(optarg, "nm")) {
+                    cmd->position_unit = POS_UNIT_NM;
+                } else if (streq(optarg, "mm")) {
+                    cmd->position_unit = POS_UNIT_MM;
+                } else {
+                    fprintf(stderr, "%s: Invalid position unit '%s'\n", program_name, optarg);
+                    return -1;
+                }
+                break;
+
+                /*  Spectral figures of ADC curves */
+            case spectrum:
+                cmd->spectrum_call = 1;
+                break;
+
+                /*  Betatron tunes of TBT positions */
+            case tune:
+                cmd->tune_call = 1;
+                break;
+
+                /*  SW delay sweep */
+            case swsweep:
+                cmd->sw_sweep_call = 1;
+                cmd->sw_sweep_step = 1;
+                if (sscanf(optarg, "%" SCNu32 ":%" SCNu32 ":%" SCNu32, &cmd->sw_sweep_first,
+                            &cmd->sw_sweep_last, &cmd->sw_sweep_step) < 2 ||
+                        cmd->sw_sweep_step == 0 || cmd->sw_sweep_last < cmd->sw_sweep_first) {
+                    fprintf(stderr, "%s: Invalid SW delay sweep '%s'\n", program_name, optarg);
+                    return -1;
+                }
+                break;
+
+                /*  Metadata sidecar */
+            case metadata:
+                cmd->metadata_template = strdup(optarg);
+                break;
+
+            case metadatafile:
+                cmd->metadata_file = strdup(optarg);
+                break;
+
+                /*  Expected acquisition rate */
+            case acqrate:
+                cmd->acq_rate = strtod(optarg, NULL);
+                if (cmd->acq_rate <= 0) {
+                    fprintf(stderr, "%s: The acquisition rate must be greater than 0\n", program_name);
+                    return -1;
+                }
                 break;
 
             default:
                 fprintf(stderr, "%s: bad option\n", program_name);
-                print_usage(program_name, stderr, 1);
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Parse a list of numbers and ranges such as "0-3,7" into list. Returns
+ * the number of entries, or -1 if str is malformed or has more than max
+ * entries */
+static int _parse_number_list (const char *str, uint32_t *list, int max)
+{
+    int num = 0;
+    const char *p = str;
+
+    while (1) {
+        char *end;
+        unsigned long first = strtoul (p, &end, 10);
+        unsigned long last = first;
+        if (end == p) {
+            return -1;
+        }
+
+        p = end;
+        if (*p == '-') {
+            last = strtoul (++p, &end, 10);
+            if (end == p || last < first) {
+                return -1;
+            }
+            p = end;
+        }
+
+        for (unsigned long number = first; number <= last; number++) {
+            if (num == max) {
+                return -1;
+            }
+            list[num++] = number;
+        }
+
+        if (*p == '\0') {
+            break;
+        }
+        if (*p++ != ',') {
+            return -1;
         }
     }
 
-    /* User input error handling */
+    return num;
+}
 
+/* Validate the parsed options and derive the values used by client_cmd_exec.
+ * Returns 0 if the command can be executed and -1 otherwise */
+static int client_cmd_check (client_cmd_t *cmd, const char *program_name)
+{
     /* Use default local broker endpoint if none was given */
-    if (broker_endp == NULL){
-        broker_endp = strdup(default_broker_endp);
+    if (cmd->broker_endp == NULL){
+        cmd->broker_endp = strdup("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    /* The command line of --batch only gives the defaults of its lines */
+    if (cmd->batch_file != NULL && cmd->num_cmd_opts > 0) {
+        fprintf(stderr, "%s: --batch only takes -e, -d, -m, -v and --stats along with it\n",
+                program_name);
+        return -1;
     }
 
     /* Check if the board number is within range and set to default if necessary */
-    if (board_number_str == NULL) {
+    if (cmd->board_number_str == NULL) {
         fprintf (stderr, "[client]: Setting default value to BOARD number: %u\n",
                 DFLT_BOARD_NUMBER);
-        board_number = DFLT_BOARD_NUMBER;
+        cmd->board_list[0] = DFLT_BOARD_NUMBER;
+        cmd->num_boards = 1;
     } else {
-        board_number = strtoul (board_number_str, NULL, 10);
+        int num_boards = _parse_number_list (cmd->board_number_str, cmd->board_list, MAX_NUM_BOARDS);
+        if (num_boards <= 0) {
+            fprintf(stderr, "%s: Invalid board list '%s' (at most %u boards)\n", program_name,
+                    cmd->board_number_str, MAX_NUM_BOARDS);
+            return -1;
+        }
+        cmd->num_boards = num_boards;
     }
+    cmd->board_number = cmd->board_list[0];
 
     /* Check if the bpm number is within range and set to default if necessary */
-    if (bpm_number_str == NULL) {
+    if (cmd->bpm_number_str == NULL) {
         fprintf (stderr, "[client]: Setting default value to BPM number: %u\n",
                 DFLT_BPM_NUMBER);
-        bpm_number = DFLT_BPM_NUMBER;
+        cmd->bpm_list[0] = DFLT_BPM_NUMBER;
+        cmd->num_bpms = 1;
     } else {
-        bpm_number = strtoul (bpm_number_str, NULL, 10);
+        int num_bpms = _parse_number_list (cmd->bpm_number_str, cmd->bpm_list, MAX_NUM_BPMS);
+        if (num_bpms <= 0) {
+            fprintf(stderr, "%s: Invalid bpm list '%s' (at most %u bpms)\n", program_name,
+                    cmd->bpm_number_str, MAX_NUM_BPMS);
+            return -1;
+        }
+        cmd->num_bpms = num_bpms;
     }
+    cmd->bpm_number = cmd->bpm_list[0];
 
-    if (acq_chan_set && (acq_chan_val >= END_CHAN_ID)) {
-        fprintf(stderr, "%s: Invalid channel selected! This value must be lower than %u \n", program_name, END_CHAN_ID-1);
-        exit(EXIT_FAILURE);
+    if (cmd->monitor_rate > 0 && cmd->num_boards*cmd->num_bpms > 1) {
+        fprintf(stderr, "%s: --monitor works on a single board and bpm\n", program_name);
+        return -1;
+    }
+
+    /* The targets behind the first one are held until it is done */
+    if (cmd->acq_loop_call && cmd->acq_loop_count == 0 && cmd->num_boards*cmd->num_bpms > 1) {
+        fprintf(stderr, "%s: --loop inf works on a single board and bpm\n", program_name);
+        return -1;
+    }
+
+    if ((cmd->metadata_template == NULL) != (cmd->metadata_file == NULL)) {
+        fprintf(stderr, "%s: --metadata and --metadatafile must be given together\n", program_name);
+        return -1;
+    }
+
+    if (cmd->metadata_template != NULL && cmd->num_boards*cmd->num_bpms > 1) {
+        fprintf(stderr, "%s: --metadata works on a single board and bpm\n", program_name);
+        return -1;
+    }
+
+    if (cmd->monitor_rate > 0 && (cmd->acq_start_call || cmd->acq_check_call || cmd->acq_get_block ||
+                cmd->acq_get_curve_call || cmd->acq_full_call)) {
+        fprintf(stderr, "%s: --monitor can not be combined with acquisition functions\n", program_name);
+        return -1;
+    }
+
+    if (cmd->num_jobs == 0) {
+        fprintf(stderr, "%s: --jobs must be greater than 0\n", program_name);
+        return -1;
+    }
+
+    if (cmd->fmt_threads == 0) {
+        long num_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        cmd->fmt_threads = (num_cpus > 0) ? (uint32_t) num_cpus : 1;
+    }
+
+    if (cmd->acq_chan_set) {
+        int num_chans = _parse_number_list (cmd->acq_chan_str, cmd->acq_chan_list, END_CHAN_ID);
+        if (num_chans <= 0) {
+            fprintf(stderr, "%s: Invalid channel list '%s' (at most %u channels)\n", program_name,
+                    cmd->acq_chan_str, END_CHAN_ID);
+            return -1;
+        }
+        for (int i = 0; i < num_chans; i++) {
+            if (cmd->acq_chan_list[i] >= END_CHAN_ID) {
+                fprintf(stderr, "%s: Invalid channel selected! This value must be lower than %u \n", program_name, END_CHAN_ID-1);
+                return -1;
+            }
+        }
+        cmd->num_acq_chans = num_chans;
+    } else {
+        cmd->acq_chan_list[0] = cmd->acq_chan_val;
+        cmd->num_acq_chans = 1;
     }
+    cmd->acq_chan_val = cmd->acq_chan_list[0];
 
-    if ((acq_check_call && check_poll) && (poll_timeout == 0)) {
+    if ((cmd->acq_check_call && cmd->check_poll) && (cmd->poll_timeout == 0)) {
         fprintf(stderr, "%s: If --acqcheckpoll is set, --timeout must be too!\n", program_name);
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
-    if (acq_full_call && (acq_start_call || acq_check_call || acq_get_block || acq_get_curve_call)) {
+    if (cmd->acq_full_call && (cmd->acq_start_call || cmd->acq_check_call || cmd->acq_get_block || cmd->acq_get_curve_call)) {
         fprintf(stderr, "%s: If --fullacq is requested, the other acquisition functions don't need to be called. Executing --fullacq only...\n", program_name);
-        acq_start_call = 0;
-        acq_check_call = 0;
-        acq_get_block = 0;
-        acq_get_curve_call = 0;
+        cmd->acq_start_call = 0;
+        cmd->acq_check_call = 0;
+        cmd->acq_get_block = 0;
+        cmd->acq_get_curve_call = 0;
+    }
+
+    if (cmd->acq_pershot_call && !cmd->acq_full_call && !cmd->acq_get_curve_call) {
+        fprintf(stderr, "%s: --pershot requires --getcurve or --fullacq\n", program_name);
+        return -1;
+    }
+
+    if (cmd->acq_loop_call && (!cmd->acq_full_call || cmd->acq_stream_call)) {
+        fprintf(stderr, "%s: --loop requires --fullacq and can not be combined with --stream or --pershot\n", program_name);
+        return -1;
+    }
+
+    if (cmd->hash_file != NULL && cmd->hash_alg == CURVE_HASH_NONE) {
+        fprintf(stderr, "%s: --hashfile requires --hash\n", program_name);
+        return -1;
+    }
+
+    if (cmd->num_acq_chans > 1 && (!cmd->acq_full_call || cmd->acq_stream_call)) {
+        fprintf(stderr, "%s: A channel list requires --fullacq and can not be combined with --stream or --pershot\n", program_name);
+        return -1;
+    }
+
+    if (cmd->acq_stream_call && (cmd->acq_stream_bufs < 2 || cmd->acq_stream_bufs > ACQ_STREAM_MAX_NUM_BUFS)) {
+        fprintf(stderr, "%s: Invalid number of stream buffers! This value must be between 2 and %u\n",
+                program_name, ACQ_STREAM_MAX_NUM_BUFS);
+        return -1;
     }
 
     /* Check filefmt option. filefmt has the default value of 0 (text mode) */
-    if ((acq_full_call || acq_get_block || acq_get_curve_call) && filefmt_str != NULL) {
-        filefmt_val = strtoul (filefmt_str, NULL, 10);
+    if ((cmd->acq_full_call || cmd->acq_get_block || cmd->acq_get_curve_call) && cmd->filefmt_str != NULL) {
+        cmd->filefmt_val = strtoul (cmd->filefmt_str, NULL, 10);
 
-        if (filefmt_val > END_FILE_FMT-1) {
+        if (cmd->filefmt_val > END_FILE_FMT-1) {
             fprintf (stderr, "[client:acq]: Invalid file format (--filefmt).\n");
-            exit (EXIT_FAILURE);
+            return -1;
         }
     }
 
-    /* If we are here, all the parameters are good and the functions can be executed */
-    halcs_client_t *halcs_client = halcs_client_new (broker_endp, verbose, NULL);
-    acq_client_t *acq_client = acq_client_new (broker_endp, verbose, NULL);
-    if (halcs_client == NULL || acq_client == NULL) {
-        fprintf(stderr, "[client]: Error in memory allocation for halcs_client\n");
-        exit(EXIT_FAILURE);
+    if (cmd->acq_get_block && cmd->filefmt_val == CONTAINER) {
+        fprintf (stderr, "[client:acq]: The container format (--filefmt 2) holds whole curves, not blocks\n");
+        return -1;
     }
 
-    /* Call all functions from the FMC130M_4CH, SWAP and DSP Module that the user specified */
-    call_func_t* function = (call_func_t *)zlist_first (call_list);
+    if (cmd->reduce != REDUCE_NONE && (cmd->filefmt_str != NULL || cmd->acq_pershot_call)) {
+        fprintf (stderr, "[client:acq]: --reduce replaces the curve output and can not be combined "
+                "with --filefmt or --pershot\n");
+        return -1;
+    }
 
-    for ( ; function != NULL; function = zlist_next (call_list))
-    {
-        int str_length = snprintf(NULL, 0, "HALCS%u:DEVIO:%s%u", board_number, function->service, bpm_number);
-        char *func_service = zmalloc (str_length+1);
-        sprintf (func_service, "HALCS%u:DEVIO:%s%u", board_number, function->service, bpm_number);
-        const disp_op_t* func_structure = halcs_func_translate (function->name);
-        halcs_client_err_e err = halcs_func_exec (halcs_client, func_structure, func_service, function->write_val, function->read_val);
+    if (cmd->position_call) {
+        if (cmd->reduce != REDUCE_NONE || cmd->acq_pershot_call ||
+                (cmd->filefmt_val != TEXT && cmd->filefmt_val != BINARY)) {
+            fprintf (stderr, "[client:acq]: --position writes text or binary (--filefmt 0 or 1) rows and "
+                    "can not be combined with --reduce or --pershot\n");
+            return -1;
+        }
+        for (uint32_t i = 0; i < cmd->num_acq_chans; i++) {
+            uint32_t chan = cmd->acq_chan_list[i];
+            if (chan != 6 && chan != 11 && chan != 14) {
+                fprintf (stderr, "[client:acq]: --position needs an amplitude channel (6 -> TBT Amp, "
+                        "11 -> FOFB Amp or 14 -> Monit Amp), not %u\n", chan);
+                return -1;
+            }
+        }
+    }
 
-        if (err != HALCS_CLIENT_SUCCESS) {
-            fprintf (stderr, "[client]: %s\n",halcs_client_err_str (err));
-            exit(EXIT_FAILURE);
+    if (cmd->spectrum_call) {
+        if (cmd->reduce != REDUCE_NONE || cmd->position_call || cmd->filefmt_str != NULL ||
+                cmd->acq_stream_call) {
+            fprintf (stderr, "[client:acq]: --spectrum needs whole curves and can not be combined with "
+                    "--reduce, --position, --filefmt, --stream or --pershot\n");
+            return -1;
+        }
+        for (uint32_t i = 0; i < cmd->num_acq_chans; i++) {
+            if (cmd->acq_chan_list[i] != 0 && cmd->acq_chan_list[i] != 1) {
+                fprintf (stderr, "[client:acq]: --spectrum needs an ADC channel (0 -> ADC or 1 -> ADC_SWAP), "
+                        "not %u\n", cmd->acq_chan_list[i]);
+                return -1;
+            }
         }
+    }
 
-        if (func_structure->retval != DISP_ARG_END && function->rw) {
-            print_func_v(1, function);
+    if (cmd->tune_call) {
+        if (cmd->reduce != REDUCE_NONE || cmd->position_call || cmd->spectrum_call ||
+                cmd->filefmt_str != NULL || cmd->acq_stream_call) {
+            fprintf (stderr, "[client:acq]: --tune needs whole curves and can not be combined with "
+                    "--reduce, --position, --spectrum, --filefmt, --stream or --pershot\n");
+            return -1;
+        }
+        for (uint32_t i = 0; i < cmd->num_acq_chans; i++) {
+            if (cmd->acq_chan_list[i] != 8) {
+                fprintf (stderr, "[client:acq]: --tune needs the TBT position channel (8 -> TBT Pos), "
+                        "not %u\n", cmd->acq_chan_list[i]);
+                return -1;
+            }
         }
-        free (func_service);
     }
-    zlist_destroy (&call_list);
 
-    /***** Acquisition module routines *****/
-    char acq_service[20];
-    sprintf (acq_service, "HALCS%u:DEVIO:ACQ%u", board_number, bpm_number);
+    if (cmd->sw_sweep_call) {
+        if (!cmd->acq_full_call || cmd->acq_loop_call || cmd->acq_stream_call || cmd->num_acq_chans > 1 ||
+                cmd->reduce != REDUCE_NONE || cmd->position_call || cmd->spectrum_call ||
+                cmd->tune_call || cmd->filefmt_str != NULL) {
+            fprintf (stderr, "[client:acq]: --swsweep requires --fullacq of a single channel and can not be "
+                    "combined with --loop, --stream, --pershot, --filefmt or the other analyses\n");
+            return -1;
+        }
+        if (cmd->acq_chan_val != 0 && cmd->acq_chan_val != 1) {
+            fprintf (stderr, "[client:acq]: --swsweep needs an ADC channel (0 -> ADC or 1 -> ADC_SWAP), "
+                    "not %u\n", cmd->acq_chan_val);
+            return -1;
+        }
+    }
 
-    /* Request data acquisition on server */
-    acq_total_samples_val = (acq_samples_pre_val+acq_samples_post_val)*acq_num_shots_val;
-
-    if (acq_start_call) {
-    /* Wrap the data request parameters */
-        acq_req_t acq_req = {
-            .num_samples_pre = acq_samples_pre_val,
-            .num_samples_post = acq_samples_post_val,
-            .num_shots = acq_num_shots_val,
-            .chan = acq_chan_val
-        };
+    if (cmd->acq_stream_call && cmd->filefmt_val == COLUMNS) {
+        fprintf (stderr, "[client:acq]: The columns format (--filefmt 3) needs whole curves and can not be "
+                "combined with --stream or --pershot\n");
+        return -1;
+    }
 
-        halcs_client_err_e err = acq_start(acq_client, acq_service, &acq_req);
-        if (err != HALCS_CLIENT_SUCCESS) {
-            fprintf (stderr, "[client:acq]: '%s'\n", halcs_client_err_str(err));
-            exit(EXIT_FAILURE);
-        }
+    return 0;
+}
+
+static int client_session_open (client_session_t *session, const char *broker_endp, int verbose)
+{
+    memset (session, 0, sizeof (*session));
+
+    /* Each command addresses its own board/bpm */
+    session->lib = client_lib_open (broker_endp, DFLT_BOARD_NUMBER, DFLT_BPM_NUMBER, verbose);
+    if (session->lib == NULL) {
+        fprintf(stderr, "[client]: Error in memory allocation for halcs_client\n");
+        return -1;
     }
 
-    /* Check if the previous acquisition has finished */
-    if (acq_check_call) {
-        if (check_poll) {
-            func_polling (halcs_client, ACQ_NAME_CHECK_DATA_ACQUIRE, acq_service, NULL, NULL, poll_timeout);
-        } else {
-            halcs_client_err_e err = acq_check(acq_client, acq_service);
-            if (err != HALCS_CLIENT_SUCCESS) {
-                fprintf (stderr, "[client:acq]: '%s'\n", halcs_client_err_str(err));
-            }
-        }
+    session->out_fp = stdout;
+    if (curve_fmt_out_init (&session->curve_out, STDOUT_FILENO, CURVE_FMT_DFLT_BUF_SIZE) < 0) {
+        fprintf(stderr, "[client]: Error in memory allocation for the output buffer\n");
+        goto err_out_alloc;
     }
+    session->curve_out.sync_fp = session->out_fp;
+    acq_buf_pool_init (&session->buf_pool, 0);
+    curve_fmt_pool_init (&session->fmt_pool, 1);
+    session->curve_out.pool = &session->fmt_pool;
+    curve_spectrum_plan_init (&session->spectrum_plan);
+    curve_tune_plan_init (&session->tune_plan);
 
-    const acq_chan_t *acq_chan = acq_get_chan (acq_client);
+    return 0;
 
-    /* Retrieve specific data block */
-    if (acq_get_block) {
-        uint32_t data_size = acq_total_samples_val*acq_chan[acq_chan_val].sample_size;
-        uint32_t *valid_data = (uint32_t *) zmalloc (data_size*sizeof (uint8_t));
-        acq_trans_t acq_trans = {
-            .req = {
-                .chan = acq_chan_val,
-            },
-            .block = {
-                .idx = acq_block_id,
-                .data = valid_data,
-                .data_size = data_size
-            }
-        };
+err_out_alloc:
+    client_lib_close (session->lib);
+    session->lib = NULL;
+    return -1;
+}
 
-        halcs_client_err_e err = acq_get_data_block (acq_client, acq_service, &acq_trans);
+/* Send everything the session outputs from now on to fp */
+static void client_session_set_output (client_session_t *session, FILE *fp)
+{
+    curve_fmt_flush (&session->curve_out);
+    fflush (session->out_fp);
 
-        if (err == HALCS_CLIENT_SUCCESS) {
-            PRINTV (verbose, "[client:acq]: halcs_get_block was successfully executed\n");
-            print_data_curve (acq_chan_val, acq_trans.block.data, acq_trans.block.bytes_read,
-                    filefmt_val);
-        } else {
-            fprintf (stderr, "[client:acq]: halcs_get_block failed\n");
+    session->out_fp = fp;
+    session->curve_out.fd = fileno (fp);
+    session->curve_out.sync_fp = fp;
+}
+
+static void client_session_close (client_session_t *session)
+{
+    curve_fmt_out_destroy (&session->curve_out);
+    acq_buf_pool_destroy (&session->buf_pool);
+    curve_fmt_pool_destroy (&session->fmt_pool);
+    curve_spectrum_plan_destroy (&session->spectrum_plan);
+    curve_tune_plan_destroy (&session->tune_plan);
+    for (uint32_t l = 0; l < PIPELINE_MAX_LANES; l++) {
+        client_lib_close (session->lane_sessions[l]);
+    }
+    client_lib_close (session->lib);
+    session->lib = NULL;
+}
+
+typedef struct {
+    const char *module;
+    char func_service[CLIENT_LIB_SERVICE_MAX_LEN];
+    client_lib_session_t *lib;
+    /* Session slot of the lane connection, opened by the lane itself if
+     * lib is NULL */
+    client_lib_session_t **lib_slot;
+    const char *broker_endp;
+    uint32_t board;
+    uint32_t bpm;
+    int verbose;
+    /* Items of this service, in command line order */
+    call_func_t *items[MAX_CALL_LIST_ITEMS];
+    uint32_t num_items;
+} pipeline_lane_t;
+
+static void *_pipeline_lane_run (void *arg)
+{
+    pipeline_lane_t *lane = (pipeline_lane_t *) arg;
+
+    if (lane->lib == NULL) {
+        *lane->lib_slot = client_lib_open (lane->broker_endp, lane->board, lane->bpm, lane->verbose);
+        lane->lib = *lane->lib_slot;
+    }
+
+    for (uint32_t i = 0; i < lane->num_items; i++) {
+        if (lane->lib == NULL) {
+            lane->items[i]->err = HALCS_CLIENT_ERR_ALLOC;
+            continue;
         }
-        free(valid_data);
+        if (zctx_interrupted) {
+            lane->items[i]->err = HALCS_CLIENT_INT;
+            continue;
+        }
+        lane->items[i]->err = client_lib_exec (lane->lib, lane->module, lane->items[i]->name,
+                lane->items[i]->write_val, lane->items[i]->read_val);
     }
+    return NULL;
+}
 
-    /* Returns a whole data curve */
-    if (acq_get_curve_call) {
-        uint32_t data_size = acq_total_samples_val*acq_chan[acq_chan_val].sample_size;
-        uint32_t *valid_data = (uint32_t *) zmalloc (data_size*sizeof (uint8_t));
-
-        acq_trans_t acq_trans = {
-            .req = {
-                .num_samples_pre = acq_samples_pre_val,
-                .num_samples_post = acq_samples_post_val,
-                .num_shots = acq_num_shots_val,
-                .chan = acq_chan_val  },
-            .block = {
-                .data = valid_data,
-                .data_size = data_size }
-        };
+/* Execute the call_list with one lane per service. Lanes run concurrently,
+ * each on its own connection, and keep the order of the items within the
+ * service. Every item runs even if others fail: results are printed in
+ * command line order and all errors are reported at the end */
+static int client_call_list_pipeline (client_session_t *session, client_cmd_t *cmd)
+{
+    int ret = 0;
+    pipeline_lane_t *lanes = zmalloc (PIPELINE_MAX_LANES*sizeof (pipeline_lane_t));
+    uint32_t num_lanes = 0;
+    if (lanes == NULL) {
+        fprintf (stderr, "[client:pipeline]: Error in memory allocation for the lanes\n");
+        return -1;
+    }
 
-        halcs_client_err_e err = acq_get_curve(acq_client, acq_service, &acq_trans);
+    call_func_t* function = (call_func_t *)zlist_first (cmd->call_list);
+    for ( ; function != NULL; function = zlist_next (cmd->call_list)) {
+        uint32_t l;
+        for (l = 0; l < num_lanes && !streq (lanes[l].module, function->service); l++);
+
+        /* Services beyond the lane limit share the last lane */
+        if (l == num_lanes && num_lanes == PIPELINE_MAX_LANES) {
+            l = num_lanes - 1;
+        } else if (l == num_lanes) {
+            lanes[l].module = function->service;
+            client_lib_format_service (lanes[l].func_service, cmd->board_number, function->service,
+                    cmd->bpm_number);
+            num_lanes++;
+        }
 
-        if (err == HALCS_CLIENT_SUCCESS) {
-            print_data_curve (acq_chan_val, acq_trans.block.data, acq_trans.block.bytes_read,
-                    filefmt_val);
-            PRINTV (verbose, "[client:acq]: acq_get_curve was successfully executed\n");
-        } else {
-            fprintf (stderr, "[client:acq]: acq_get_curve failed: %s\n", halcs_client_err_str(err));
-            exit(EXIT_FAILURE);
+        if (lanes[l].num_items == MAX_CALL_LIST_ITEMS) {
+            fprintf (stderr, "[client:pipeline]: More than %u functions for service %s\n",
+                    MAX_CALL_LIST_ITEMS, lanes[l].func_service);
+            free (lanes);
+            return -1;
         }
-        acq_get_curve_call = 0;
-        free(valid_data);
+        function->err = HALCS_CLIENT_SUCCESS;
+        lanes[l].items[lanes[l].num_items++] = function;
     }
 
-    /* Perform a full acquisition routine and return a data curve */
-    if (acq_full_call) {
-        uint32_t data_size = acq_total_samples_val*acq_chan[acq_chan_val].sample_size;
-        uint32_t *valid_data = (uint32_t *) zmalloc (data_size*sizeof (uint8_t));
-
-        acq_trans_t acq_trans = {
-            .req = {
-                .num_samples_pre = acq_samples_pre_val,
-                .num_samples_post = acq_samples_post_val,
-                .num_shots = acq_num_shots_val,
-                .chan = acq_chan_val  },
-            .block = {
-                .data = valid_data,
-                .data_size = data_size }
-        };
+    /* The first lane uses the session connection. The others open their own
+     * on first use, which the session keeps for the following commands */
+    for (uint32_t l = 0; l < num_lanes; l++) {
+        lanes[l].lib = (l == 0) ? session->lib : session->lane_sessions[l];
+        lanes[l].lib_slot = &session->lane_sessions[l];
+        lanes[l].broker_endp = client_lib_broker_endp (session->lib);
+        lanes[l].board = cmd->board_number;
+        lanes[l].bpm = cmd->bpm_number;
+        lanes[l].verbose = cmd->verbose;
+        if (lanes[l].lib != NULL) {
+            client_lib_set_target (lanes[l].lib, cmd->board_number, cmd->bpm_number);
+        }
+    }
 
-        halcs_client_err_e err = acq_full(acq_client, acq_service, &acq_trans, poll_timeout);
+    pthread_t threads[PIPELINE_MAX_LANES];
+    int started[PIPELINE_MAX_LANES] = {0};
+    for (uint32_t l = 1; l < num_lanes; l++) {
+        started[l] = (pthread_create (&threads[l], NULL, _pipeline_lane_run, &lanes[l]) == 0);
+    }
 
-        if (err != HALCS_CLIENT_SUCCESS) {
-            fprintf (stderr, "[client:acq]: %s\n", halcs_client_err_str(err));
-            exit(EXIT_FAILURE);
+    /* Lanes without a thread of their own run here, on the session connection */
+    for (uint32_t l = 0; l < num_lanes; l++) {
+        if (!started[l]) {
+            lanes[l].lib = session->lib;
+            _pipeline_lane_run (&lanes[l]);
         }
-        print_data_curve (acq_chan_val, acq_trans.block.data, acq_trans.block.bytes_read,
-                filefmt_val);
-        acq_full_call = 0;
-        free(valid_data);
     }
 
-    /* Deallocate memory */
-    free (filefmt_str);
-    free (default_broker_endp);
-    free (broker_endp);
-    free (board_number_str);
-    free (bpm_number_str);
-    halcs_client_destroy (&halcs_client);
-    acq_client_destroy (&acq_client);
+    for (uint32_t l = 1; l < num_lanes; l++) {
+        if (started[l]) {
+            pthread_join (threads[l], NULL);
+        }
+    }
+
+    function = (call_func_t *)zlist_first (cmd->call_list);
+    for ( ; function != NULL; function = zlist_next (cmd->call_list)) {
+        const disp_op_t* func_structure = halcs_func_translate (function->name);
+        if (function->err == HALCS_CLIENT_SUCCESS && func_structure->retval != DISP_ARG_END &&
+                function->rw) {
+            print_func_v(session->out_fp, 1, function);
+        }
+    }
+
+    for (uint32_t l = 0; l < num_lanes; l++) {
+        for (uint32_t i = 0; i < lanes[l].num_items; i++) {
+            if (lanes[l].items[i]->err != HALCS_CLIENT_SUCCESS) {
+                fprintf (stderr, "[client:pipeline]: %s on %s: %s\n", lanes[l].items[i]->name,
+                        lanes[l].func_service, halcs_client_err_str (lanes[l].items[i]->err));
+                ret = -1;
+            }
+        }
+    }
+
+    free (lanes);
+    return ret;
+}
+
+#define NSECS_PER_SEC               1000000000LL
+
+static int64_t _timespec_ns (const struct timespec *ts)
+{
+    return (int64_t) ts->tv_sec*NSECS_PER_SEC + ts->tv_nsec;
+}
+
+static struct timespec _ns_timespec (int64_t ns)
+{
+    struct timespec ts = {
+        .tv_sec = ns / NSECS_PER_SEC,
+        .tv_nsec = ns % NSECS_PER_SEC
+    };
+    return ts;
+}
+
+/* Poll the read functions of the call_list at cmd->monitor_rate. Sampling
+ * instants are absolute deadlines on a fixed grid, so execution jitter does
+ * not accumulate. A sample that can not be taken before its deadline is
+ * skipped and counted as missed. Each record holds the CLOCK_REALTIME
+ * timestamp [ns] taken right before the reads, followed by the read values.
+ * Write functions are executed once, before the first sample */
+static int client_monitor_run (client_session_t *session, client_cmd_t *cmd)
+{
+    int ret = 0;
+    FILE *fp = session->out_fp;
+    call_func_t *reads[MAX_CALL_LIST_ITEMS];
+    uint32_t num_reads = 0;
+
+    call_func_t* function = (call_func_t *)zlist_first (cmd->call_list);
+    for ( ; function != NULL; function = zlist_next (cmd->call_list)) {
+        if (!function->rw) {
+            halcs_client_err_e err = client_lib_exec (session->lib, function->service,
+                    function->name, function->write_val, function->read_val);
+            if (err != HALCS_CLIENT_SUCCESS) {
+                fprintf (stderr, "[client:monitor]: %s: %s\n", function->name, halcs_client_err_str (err));
+                return -1;
+            }
+            continue;
+        }
+
+        if (num_reads == MAX_CALL_LIST_ITEMS) {
+            fprintf (stderr, "[client:monitor]: At most %u functions can be monitored\n",
+                    MAX_CALL_LIST_ITEMS);
+            return -1;
+        }
+        reads[num_reads++] = function;
+    }
+
+    if (num_reads == 0) {
+        fprintf (stderr, "[client:monitor]: No get function was given to monitor\n");
+        return -1;
+    }
+
+    if (cmd->monitor_file != NULL) {
+        fp = fopen (cmd->monitor_file, "w");
+        if (fp == NULL) {
+            fprintf (stderr, "[client:monitor]: Could not open '%s'\n", cmd->monitor_file);
+            return -1;
+        }
+    }
+
+    fprintf (fp, "# timestamp_ns");
+    for (uint32_t i = 0; i < num_reads; i++) {
+        fprintf (fp, "\t%s", reads[i]->name);
+    }
+    fprintf (fp, "\n");
+    fflush (fp);
+
+    int64_t period_ns = (int64_t) (NSECS_PER_SEC/cmd->monitor_rate);
+    uint64_t num_samples = 0;
+    uint64_t num_missed = 0;
+    uint64_t num_errors = 0;
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    int64_t start_ns = _timespec_ns (&ts);
+    int64_t deadline_ns = start_ns;
+    int64_t last_sample_ns = start_ns;
+
+    while (!zctx_interrupted && (cmd->monitor_count == 0 || num_samples < cmd->monitor_count)) {
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        last_sample_ns = _timespec_ns (&ts);
+        clock_gettime (CLOCK_REALTIME, &ts);
+        fprintf (fp, "%" PRId64, _timespec_ns (&ts));
+
+        for (uint32_t i = 0; i < num_reads; i++) {
+            char value[64];
+            halcs_client_err_e err = client_lib_exec (session->lib, reads[i]->service,
+                    reads[i]->name, reads[i]->write_val, reads[i]->read_val);
+            if (err == HALCS_CLIENT_SUCCESS) {
+                snprint_var (value, sizeof (value), reads[i]);
+            } else {
+                snprintf (value, sizeof (value), "nan");
+                num_errors++;
+            }
+            fprintf (fp, "\t%s", value);
+        }
+        fprintf (fp, "\n");
+        fflush (fp);
+        num_samples++;
+
+        /* Stay on the grid: skip the deadlines that already passed */
+        deadline_ns += period_ns;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        int64_t now_ns = _timespec_ns (&ts);
+        if (now_ns > deadline_ns) {
+            int64_t late = (now_ns - deadline_ns) / period_ns + 1;
+            num_missed += late;
+            deadline_ns += late*period_ns;
+        }
+
+        if (cmd->monitor_count != 0 && num_samples == cmd->monitor_count) {
+            break;
+        }
+
+        struct timespec deadline = _ns_timespec (deadline_ns);
+        while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR &&
+                !zctx_interrupted);
+    }
+
+    /* Rate between the first and the last sampling instants */
+    double elapsed = (last_sample_ns - start_ns) / (double) NSECS_PER_SEC;
+    fprintf (stderr, "[client:monitor]: %" PRIu64 " samples in %.3f s (%.3f Hz, requested %.3f Hz), "
+            "%" PRIu64 " missed deadlines, %" PRIu64 " read errors\n",
+            num_samples, elapsed, (elapsed > 0) ? (num_samples-1)/elapsed : 0.0, cmd->monitor_rate,
+            num_missed, num_errors);
+
+    if (fp != session->out_fp) {
+        if (fclose (fp) != 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/* Start the acquisition of chan with the samples and shots of cmd */
+static halcs_client_err_e acq_start_chan (client_session_t *session, const client_cmd_t *cmd,
+        uint32_t chan)
+{
+    return client_lib_acq_start (session->lib, chan, cmd->acq_samples_pre_val,
+            cmd->acq_samples_post_val, cmd->acq_num_shots_val);
+}
+
+/* Wait for the end of the last acquisition of the session for up to
+ * --timeout ms */
+static halcs_client_err_e acq_wait_data (const client_session_t *session, const client_cmd_t *cmd)
+{
+    halcs_client_err_e err = client_lib_acq_wait (session->lib, cmd->poll_timeout);
+
+    if (err == HALCS_CLIENT_SUCCESS) {
+        client_lib_acq_wait_info_t info;
+        client_lib_acq_wait_info (session->lib, &info);
+        PRINTV (session->out_fp, cmd->verbose, "[client:acq]: Data ready after %.1f us (seen "
+                "within %.1f us, expected %.1f us, %u checks)\n", info.ready_ns/1e3,
+                info.resolution_ns/1e3, info.expected_ns/1e3, info.num_checks);
+    }
+    return err;
+}
+
+static int64_t _realtime_ns (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    return _timespec_ns (&ts);
+}
+
+/* Container header of the curve of chan requested by cmd */
+static void _curve_container_hdr (acq_container_hdr_t *hdr, const client_session_t *session,
+        const client_cmd_t *cmd, uint32_t chan, uint64_t sequence, int64_t start_ns, int64_t end_ns)
+{
+    acq_container_hdr_init (hdr, chan, client_lib_acq_sample_size (session->lib, chan),
+            cmd->acq_samples_pre_val, cmd->acq_samples_post_val, cmd->acq_num_shots_val);
+    hdr->board = cmd->board_number;
+    hdr->bpm = cmd->bpm_number;
+    hdr->sequence = sequence;
+    hdr->start_ns = start_ns;
+    hdr->end_ns = end_ns;
+}
+
+/* Add a curve, or a block of it, of chan to the per lane statistics */
+static void _reduce_curve (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES], uint32_t chan,
+        const uint32_t *data, uint32_t size)
+{
+    /* Same layouts as print_data_curve */
+    if (chan == 0 || chan == 1) {
+        curve_reduce_i16x4 (stats, (const int16_t *) data, size/(4*sizeof (int16_t)));
+    } else {
+        curve_reduce_i32x4 (stats, (const int32_t *) data, size/(4*sizeof (int32_t)));
+    }
+}
+
+static int _print_curve_stats (curve_fmt_out_t *out,
+        const curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES])
+{
+    char line[256];
+    int len = snprintf (line, sizeof (line), "#lane count mean std rms min max\n");
+    int err = curve_fmt_write (out, line, len);
+
+    for (int l = 0; l < CURVE_REDUCE_NUM_LANES; l++) {
+        const curve_lane_stats_t *s = &stats[l];
+        len = snprintf (line, sizeof (line), "%c %" PRIu64 " %f %f %f %" PRId32 " %" PRId32 "\n",
+                'A' + l, s->count, s->mean, curve_lane_stats_std (s), curve_lane_stats_rms (s),
+                (s->count > 0) ? s->min : 0, (s->count > 0) ? s->max : 0);
+        err |= curve_fmt_write (out, line, len);
+    }
+    err |= curve_fmt_flush (out);
+    return (err == 0) ? 0 : -1;
+}
+
+/* Write the beam position of rows of int32x4 amplitudes as text or
+ * binary rows, POS_ROWS_PER_CHUNK rows at a time */
+static int _print_positions (curve_fmt_out_t *out, const curve_pos_gains_t *gains,
+        pos_unit_e unit, const uint32_t *data, uint32_t size, filefmt_e filefmt)
+{
+    size_t rows = size/(4*sizeof (int32_t));
+    double *pos = malloc (POS_ROWS_PER_CHUNK*4*sizeof (*pos));
+    if (pos == NULL) {
+        fprintf (stderr, "[client:acq]: Error in memory allocation for the positions\n");
+        return -1;
+    }
+
+    /* 1 pm resolution. Any 4 doubles fit in line */
+    const char *row_fmt = (unit == POS_UNIT_NM) ? "%.3f %.3f %.9f %.3f\n" : "%.9f %.9f %.9f %.3f\n";
+    char line[2048];
+    int err = 0;
+    int64_t start = client_stats_now ();
+
+    for (size_t i = 0; i < rows && err == 0; i += POS_ROWS_PER_CHUNK) {
+        if (zctx_interrupted) {
+            break;
+        }
+
+        size_t chunk = (rows - i < POS_ROWS_PER_CHUNK) ? rows - i : POS_ROWS_PER_CHUNK;
+        curve_pos_i32x4 (pos, (const int32_t *) data + 4*i, chunk, gains);
+        if (filefmt == BINARY) {
+            err = curve_fmt_write (out, pos, chunk*4*sizeof (*pos));
+            continue;
+        }
+        for (size_t r = 0; r < chunk && err == 0; r++) {
+            const double *row = pos + 4*r;
+            int len = snprintf (line, sizeof (line), row_fmt, row[0], row[1], row[2], row[3]);
+            err = curve_fmt_write (out, line, len);
+        }
+    }
+    free (pos);
+
+    if (curve_fmt_flush (out) < 0) {
+        err = -1;
+    }
+    client_stats_record (STATS_OUTPUT, start, size);
+    return err;
+}
+
+static int _print_curve_spectrum (client_session_t *session, const uint32_t *data, uint32_t size)
+{
+    curve_spectrum_t spectrum[4];
+    size_t rows = size/(4*sizeof (int16_t));
+    if (curve_spectrum_i16x4 (&session->spectrum_plan, (const int16_t *) data, rows,
+                session->spectrum_rate, spectrum) < 0) {
+        fprintf (stderr, "[client:acq]: Could not compute the spectrum of %zu samples (at least %u "
+                "are needed)\n", rows, CURVE_SPECTRUM_MIN_SIZE);
+        return -1;
+    }
+
+    curve_fmt_out_t *out = &session->curve_out;
+    char line[512];
+    int len = snprintf (line, sizeof (line), "#spectrum %zu %f\n"
+            "#lane carrier_hz carrier_dbfs snr_db sfdr_dbc thd_dbc sinad_db enob\n",
+            session->spectrum_plan.size, session->spectrum_rate);
+    int err = curve_fmt_write (out, line, len);
+
+    for (int l = 0; l < 4; l++) {
+        const curve_spectrum_t *s = &spectrum[l];
+        len = snprintf (line, sizeof (line), "%c %f %f %f %f %f %f %f\n", 'A' + l, s->carrier_freq,
+                s->carrier_dbfs, s->snr, s->sfdr, s->thd, s->sinad, s->enob);
+        err |= curve_fmt_write (out, line, len);
+    }
+    err |= curve_fmt_flush (out);
+    return (err == 0) ? 0 : -1;
+}
+
+/* Lanes of the TBT position channel analysed by --tune */
+#define TUNE_NUM_PLANES             2
+
+static int _print_curve_tune (client_session_t *session, const uint32_t *data, uint32_t size)
+{
+    static const char plane_names [TUNE_NUM_PLANES] = {'X', 'Y'};
+    size_t turns = size/(4*sizeof (int32_t));
+    curve_fmt_out_t *out = &session->curve_out;
+    char line[256];
+    int len = snprintf (line, sizeof (line), "#tune %zu\n#plane tune amplitude phase confidence\n", turns);
+    int err = curve_fmt_write (out, line, len);
+
+    for (int p = 0; p < TUNE_NUM_PLANES && err == 0; p++) {
+        curve_tune_t tune;
+        if (curve_tune_i32x4 (&session->tune_plan, (const int32_t *) data, turns, p, &tune) < 0) {
+            fprintf (stderr, "[client:acq]: Could not estimate the tune of %zu turns (at least %u "
+                    "are needed)\n", turns, CURVE_TUNE_MIN_TURNS);
+            return -1;
+        }
+        len = snprintf (line, sizeof (line), "%c %.9f %f %f %f\n", plane_names[p], tune.tune,
+                tune.amplitude, tune.phase, tune.confidence);
+        err = curve_fmt_write (out, line, len);
+    }
+    err |= curve_fmt_flush (out);
+    return (err == 0) ? 0 : -1;
+}
+
+/* Write a whole curve in the --filefmt format. start_ns and end_ns are the
+ * acquisition timestamps recorded in containers */
+static int _write_curve (client_session_t *session, const client_cmd_t *cmd, uint32_t chan,
+        uint32_t *data, uint32_t size, uint64_t sequence, int64_t start_ns, int64_t end_ns)
+{
+    if (cmd->reduce == REDUCE_STATS) {
+        curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES];
+        curve_reduce_init (stats);
+        _reduce_curve (stats, chan, data, size);
+        return _print_curve_stats (&session->curve_out, stats);
+    }
+
+    if (cmd->spectrum_call) {
+        return _print_curve_spectrum (session, data, size);
+    }
+
+    if (cmd->tune_call) {
+        return _print_curve_tune (session, data, size);
+    }
+
+    if (cmd->position_call) {
+        return _print_positions (&session->curve_out, &session->pos_gains, cmd->position_unit,
+                data, size, cmd->filefmt_val);
+    }
+
+    if (cmd->filefmt_val != CONTAINER) {
+        return print_data_curve (&session->curve_out, chan, data, size, cmd->filefmt_val);
+    }
+
+    acq_container_hdr_t hdr;
+    _curve_container_hdr (&hdr, session, cmd, chan, sequence, start_ns, end_ns);
+    if (acq_container_begin (&session->curve_out, &hdr) < 0 ||
+            print_data_curve (&session->curve_out, chan, data, size,
+                cmd->filefmt_val) < 0) {
+        return -1;
+    }
+    return acq_container_end (&session->curve_out, &hdr, size);
+}
+
+typedef struct {
+    client_session_t *session;
+    const client_cmd_t *cmd;
+    /* Bytes per shot and bytes of the current shot written so far */
+    uint64_t shot_size;
+    uint64_t shot_written;
+    uint64_t shot_n;
+    /* CLOCK_REALTIME [ns] of the acquisition start, 0 if unknown */
+    int64_t start_ns;
+    acq_container_hdr_t hdr;
+} print_shot_ctx_t;
+
+/* Start the record of the current shot, stamped with the arrival of its
+ * first block */
+static int _print_shot_begin (print_shot_ctx_t *shot_ctx)
+{
+    const client_cmd_t *cmd = shot_ctx->cmd;
+    curve_fmt_out_t *out = &shot_ctx->session->curve_out;
+    int64_t timestamp_ns = _realtime_ns ();
+
+    if (cmd->filefmt_val == CONTAINER) {
+        acq_container_hdr_t *hdr = &shot_ctx->hdr;
+        acq_container_hdr_init (hdr, cmd->acq_chan_val,
+                client_lib_acq_sample_size (shot_ctx->session->lib, cmd->acq_chan_val),
+                cmd->acq_samples_pre_val, cmd->acq_samples_post_val, 1);
+        hdr->board = cmd->board_number;
+        hdr->bpm = cmd->bpm_number;
+        hdr->sequence = shot_ctx->shot_n;
+        hdr->start_ns = shot_ctx->start_ns;
+        hdr->end_ns = timestamp_ns;
+        return acq_container_begin (out, hdr);
+    }
+
+    char header[80];
+    int len = snprintf (header, sizeof (header), "#shot:%" PRIu64 " %" PRId64 " %" PRIu64 "\n",
+            shot_ctx->shot_n, timestamp_ns, shot_ctx->shot_size);
+    return curve_fmt_write (out, header, len);
+}
+
+/* acq_stream sink of --pershot: cut the curve at the shot boundaries, so
+ * every shot is written and flushed as soon as its last block arrives.
+ * Shots hold whole samples, so rows are never split between two records.
+ * The blocks are only fetched once the whole acquisition is over: ACQ
+ * reports the completion of the acquisition, not of its shots */
+static int _print_shot_block (void *ctx, uint32_t *data, uint32_t size)
+{
+    print_shot_ctx_t *shot_ctx = (print_shot_ctx_t *) ctx;
+    const client_cmd_t *cmd = shot_ctx->cmd;
+    curve_fmt_out_t *out = &shot_ctx->session->curve_out;
+    uint8_t *bytes = (uint8_t *) data;
+
+    while (size > 0) {
+        if (shot_ctx->shot_written == 0 && _print_shot_begin (shot_ctx) < 0) {
+            return -1;
+        }
+
+        uint64_t left = shot_ctx->shot_size - shot_ctx->shot_written;
+        uint32_t len = (size < left) ? size : (uint32_t) left;
+        if (print_data_curve (out, cmd->acq_chan_val, (uint32_t *) bytes, len,
+                    cmd->filefmt_val) < 0) {
+            return -1;
+        }
+        bytes += len;
+        size -= len;
+        shot_ctx->shot_written += len;
+
+        if (shot_ctx->shot_written == shot_ctx->shot_size) {
+            if (cmd->filefmt_val == CONTAINER && acq_container_end (out, &shot_ctx->hdr,
+                        shot_ctx->shot_written) < 0) {
+                return -1;
+            }
+            shot_ctx->shot_n++;
+            shot_ctx->shot_written = 0;
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    uint32_t chan;
+    curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES];
+} reduce_block_ctx_t;
+
+/* acq_stream sink of --reduce: accumulate the statistics block by block */
+static int _reduce_data_block (void *ctx, uint32_t *data, uint32_t size)
+{
+    reduce_block_ctx_t *reduce_ctx = (reduce_block_ctx_t *) ctx;
+    _reduce_curve (reduce_ctx->stats, reduce_ctx->chan, data, size);
+    return 0;
+}
+
+typedef struct {
+    curve_fmt_out_t *out;
+    const curve_pos_gains_t *gains;
+    pos_unit_e unit;
+    filefmt_e filefmt;
+} pos_block_ctx_t;
+
+/* acq_stream sink of --position: write the positions of each block as
+ * soon as it arrives */
+static int _print_pos_block (void *ctx, uint32_t *data, uint32_t size)
+{
+    pos_block_ctx_t *pos_ctx = (pos_block_ctx_t *) ctx;
+    return _print_positions (pos_ctx->out, pos_ctx->gains, pos_ctx->unit, data, size,
+            pos_ctx->filefmt);
+}
+
+/* Stream the curve of cmd to the output, as a single record or, with
+ * --pershot, as one record per shot. start_ns and end_ns are the
+ * acquisition timestamps recorded in containers. Returns -1 if the output
+ * failed; the result of the transfer is left in *err */
+static int _stream_curve (client_session_t *session, const client_cmd_t *cmd, int64_t start_ns,
+        int64_t end_ns, halcs_client_err_e *err)
+{
+    int ret = 0;
+    uint64_t bytes_streamed = 0;
+    unsigned num_bufs = cmd->acq_stream_bufs;
+
+    if (cmd->reduce == REDUCE_STATS) {
+        reduce_block_ctx_t reduce_ctx = {
+            .chan = cmd->acq_chan_val
+        };
+        curve_reduce_init (reduce_ctx.stats);
+
+        *err = client_lib_acq_stream (session->lib, num_bufs, _reduce_data_block, &reduce_ctx,
+                &bytes_streamed);
+        return _print_curve_stats (&session->curve_out, reduce_ctx.stats);
+    }
+
+    if (cmd->position_call) {
+        pos_block_ctx_t pos_ctx = {
+            .out = &session->curve_out,
+            .gains = &session->pos_gains,
+            .unit = cmd->position_unit,
+            .filefmt = cmd->filefmt_val
+        };
+
+        *err = client_lib_acq_stream (session->lib, num_bufs, _print_pos_block, &pos_ctx,
+                &bytes_streamed);
+        return 0;
+    }
+
+    if (cmd->acq_pershot_call) {
+        print_shot_ctx_t shot_ctx = {
+            .session = session,
+            .cmd = cmd,
+            .shot_size = (uint64_t) (cmd->acq_samples_pre_val + cmd->acq_samples_post_val)*
+                client_lib_acq_sample_size (session->lib, cmd->acq_chan_val),
+            .start_ns = start_ns
+        };
+
+        *err = client_lib_acq_stream (session->lib, num_bufs, _print_shot_block, &shot_ctx,
+                &bytes_streamed);
+
+        /* Close the record of a shot cut short */
+        if (shot_ctx.shot_written != 0 && cmd->filefmt_val == CONTAINER &&
+                acq_container_end (&session->curve_out, &shot_ctx.hdr, shot_ctx.shot_written) < 0) {
+            ret = -1;
+        }
+        return ret;
+    }
+
+    print_block_ctx_t print_ctx = {
+        .out = &session->curve_out,
+        .chan = cmd->acq_chan_val,
+        .filefmt = cmd->filefmt_val
+    };
+    acq_container_hdr_t hdr;
+    if (cmd->filefmt_val == CONTAINER) {
+        _curve_container_hdr (&hdr, session, cmd, cmd->acq_chan_val, 0, start_ns, end_ns);
+        if (acq_container_begin (&session->curve_out, &hdr) < 0) {
+            return -1;
+        }
+    }
+
+    *err = client_lib_acq_stream (session->lib, num_bufs, _print_data_block, &print_ctx,
+            &bytes_streamed);
+
+    if (cmd->filefmt_val == CONTAINER && acq_container_end (&session->curve_out, &hdr,
+                bytes_streamed) < 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/* Take a curve buffer from the session pool. Its contents are undefined */
+static uint32_t *_acq_buf_get (client_session_t *session, size_t size)
+{
+    void *data = NULL;
+    int err = acq_buf_get (&session->buf_pool, size, &data);
+    if (err < 0) {
+        fprintf (stderr, "[client:acq]: Error in memory allocation for the curve buffer\n");
+        return NULL;
+    }
+    if (err > 0) {
+        fprintf (stderr, "[client:acq]: Could not lock the curve buffer in memory\n");
+    }
+    return (uint32_t *) data;
+}
+
+/* --swsweep state. The folded sums and the best delay belong to the loop
+ * writer */
+typedef struct {
+    /* RFFE switching period [ADC samples] */
+    uint32_t period;
+    int64_t *sums;
+    uint64_t num_points;
+    uint32_t best_delay;
+    double best_ripple;
+    /* SW delay before the sweep, restored unless the sweep completes */
+    uint32_t initial_delay;
+} sw_sweep_t;
+
+static uint64_t _sw_sweep_num_points (const client_cmd_t *cmd)
+{
+    return (cmd->sw_sweep_last - cmd->sw_sweep_first)/cmd->sw_sweep_step + 1;
+}
+
+static uint32_t _sw_sweep_delay (const client_cmd_t *cmd, uint64_t capture_n)
+{
+    return cmd->sw_sweep_first + (uint32_t) capture_n*cmd->sw_sweep_step;
+}
+
+static halcs_client_err_e _set_sw_delay (client_session_t *session, const client_cmd_t *cmd,
+        uint32_t delay)
+{
+    PRINTV (session->out_fp, cmd->verbose, "[client:acq]: SW delay %u\n", delay);
+    return client_lib_set (session->lib, SWAP_MODULE_NAME, SWAP_NAME_SET_GET_SW_DLY, &delay,
+            sizeof (delay));
+}
+
+/* Take the switching period from the divider clock of the board, save its
+ * SW delay and write the sweep header */
+static int _sw_sweep_init (client_session_t *session, sw_sweep_t *sweep)
+{
+    uint32_t initial_delay = 0;
+    halcs_client_err_e dly_err = client_lib_get (session->lib, SWAP_MODULE_NAME,
+            SWAP_NAME_SET_GET_SW_DLY, &initial_delay, sizeof (initial_delay));
+    if (dly_err != HALCS_CLIENT_SUCCESS) {
+        fprintf (stderr, "[client:acq]: Could not read the SW delay: %s\n",
+                halcs_client_err_str (dly_err));
+        return -1;
+    }
+
+    uint32_t div_clk = 0;
+    halcs_client_err_e err = client_lib_get (session->lib, SWAP_MODULE_NAME,
+            SWAP_NAME_SET_GET_DIV_CLK, &div_clk, sizeof (div_clk));
+    if (err != HALCS_CLIENT_SUCCESS) {
+        fprintf (stderr, "[client:acq]: Could not read the switching divider clock: %s\n",
+                halcs_client_err_str (err));
+        return -1;
+    }
+    if (div_clk == 0) {
+        fprintf (stderr, "[client:acq]: The switching divider clock is 0 (see --setdivclk)\n");
+        return -1;
+    }
+
+    memset (sweep, 0, sizeof (*sweep));
+    sweep->initial_delay = initial_delay;
+    sweep->period = 2*div_clk;
+    sweep->sums = malloc (4*(size_t) sweep->period*sizeof (*sweep->sums));
+    if (sweep->sums == NULL) {
+        fprintf (stderr, "[client:acq]: Error in memory allocation for the switching phases\n");
+        return -1;
+    }
+
+    char header[128];
+    int len = snprintf (header, sizeof (header), "#swsweep %u\n"
+            "#swdly lane state0_rms state1_rms ripple\n", sweep->period);
+    return curve_fmt_write (&session->curve_out, header, len);
+}
+
+/* Fold the curve of one SW delay over the switching period and write its
+ * switching figures */
+static int _sw_sweep_point (client_session_t *session, const client_cmd_t *cmd, sw_sweep_t *sweep,
+        uint64_t capture_n, const uint32_t *data, uint32_t size)
+{
+    uint32_t delay = _sw_sweep_delay (cmd, capture_n);
+    uint64_t rows = size/(4*sizeof (int16_t));
+    if (rows < sweep->period) {
+        fprintf (stderr, "[client:acq]: SW delay %u: %" PRIu64 " samples do not span the switching "
+                "period of %u\n", delay, rows, sweep->period);
+        return -1;
+    }
+
+    memset (sweep->sums, 0, 4*(size_t) sweep->period*sizeof (*sweep->sums));
+    curve_fold_sq_i16x4 (sweep->sums, sweep->period, 0, (const int16_t *) data, rows);
+    curve_fold_sw_t sw[4];
+    curve_fold_sw (sweep->sums, sweep->period, rows, sw);
+
+    char lines[4*128];
+    int len = 0;
+    double ripple = 0;
+    for (int l = 0; l < 4; l++) {
+        len += snprintf (lines + len, sizeof (lines) - len, "%u %c %f %f %f\n", delay, 'A' + l,
+                sw[l].state_rms[0], sw[l].state_rms[1], sw[l].ripple);
+        ripple += sw[l].ripple/4;
+    }
+    if (sweep->num_points == 0 || ripple < sweep->best_ripple) {
+        sweep->best_delay = delay;
+        sweep->best_ripple = ripple;
+    }
+    sweep->num_points++;
+
+    int err = curve_fmt_write (&session->curve_out, lines, len);
+    err |= curve_fmt_flush (&session->curve_out);
+    return (err == 0) ? 0 : -1;
+}
+
+/* Curve buffers of --loop and of channel lists: one being written while the
+ * next curve is transferred */
+#define ACQ_LOOP_NUM_BUFS           2
+
+typedef struct {
+    uint32_t *data;
+    uint32_t bytes;
+    uint64_t capture_n;
+    uint32_t chan;
+    /* CLOCK_REALTIME of the start and of the end of the acquisition [ns] */
+    int64_t start_ns;
+    int64_t timestamp_ns;
+} acq_loop_buf_t;
+
+typedef struct {
+    client_session_t *session;
+    const client_cmd_t *cmd;
+    /* With --swsweep, the curves are analysed instead of written */
+    sw_sweep_t *sweep;
+    acq_loop_buf_t bufs[ACQ_LOOP_NUM_BUFS];
+    /* Ring of captures waiting to be written: [tail, tail+count) */
+    unsigned head;
+    unsigned tail;
+    unsigned count;
+    int done;
+    int err;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t freed;
+} acq_loop_t;
+
+/* Write each capture as a "#capture:<n> <timestamp_ns> <bytes>" line
+ * followed by its data, in the --filefmt format. With a channel list, each
+ * curve of a capture has a "#capture:<n>:<chan> <timestamp_ns> <bytes>"
+ * line. Containers already carry that information, so they are written
+ * one after the other */
+static void *_acq_loop_writer (void *arg)
+{
+    acq_loop_t *loop = (acq_loop_t *) arg;
+    curve_fmt_out_t *out = &loop->session->curve_out;
+
+    while (1) {
+        pthread_mutex_lock (&loop->lock);
+        while (loop->count == 0 && !loop->done) {
+            pthread_cond_wait (&loop->filled, &loop->lock);
+        }
+        if (loop->count == 0) {
+            pthread_mutex_unlock (&loop->lock);
+            break;
+        }
+        acq_loop_buf_t *buf = &loop->bufs[loop->tail];
+        /* After a failure the remaining captures are only released */
+        int err = loop->err;
+        pthread_mutex_unlock (&loop->lock);
+
+        if (err < 0) {
+            /* Release the buffer without writing it */
+        } else if (loop->sweep != NULL) {
+            if (_sw_sweep_point (loop->session, loop->cmd, loop->sweep, buf->capture_n, buf->data,
+                        buf->bytes) < 0) {
+                err = -1;
+            }
+        } else if (loop->cmd->filefmt_val != CONTAINER) {
+            char header[80];
+            int len = (loop->cmd->num_acq_chans > 1) ?
+                snprintf (header, sizeof (header), "#capture:%" PRIu64 ":%u %" PRId64 " %u\n",
+                        buf->capture_n, buf->chan, buf->timestamp_ns, buf->bytes) :
+                snprintf (header, sizeof (header), "#capture:%" PRIu64 " %" PRId64 " %u\n",
+                        buf->capture_n, buf->timestamp_ns, buf->bytes);
+            if (curve_fmt_write (out, header, len) < 0) {
+                err = -1;
+            }
+        }
+        if (err == 0 && loop->sweep == NULL && _write_curve (loop->session, loop->cmd, buf->chan,
+                    buf->data, buf->bytes, buf->capture_n, buf->start_ns, buf->timestamp_ns) < 0) {
+            err = -1;
+        }
+
+        /* Releasing the buffer also wakes up the acquisition loop to stop
+         * on a failure */
+        pthread_mutex_lock (&loop->lock);
+        loop->err = err;
+        loop->tail = (loop->tail + 1) % ACQ_LOOP_NUM_BUFS;
+        loop->count--;
+        pthread_cond_signal (&loop->freed);
+        pthread_mutex_unlock (&loop->lock);
+    }
+
+    return NULL;
+}
+
+/* Repeat the full acquisition cmd->acq_loop_count times (0 for no limit)
+ * with --loop, once otherwise. Each capture acquires every channel of the
+ * -H list in turn: the ACQ core serves a single channel per acquisition, so
+ * the channels share the trigger setup, not the trigger event. As soon as
+ * a curve is transferred, the next acquisition is started and the curve is
+ * written by another thread while the board acquires the next one. The
+ * dead time of each cycle, from the end of an acquisition to the start of
+ * the next one, is reported on stderr */
+static int client_acq_loop_run (client_session_t *session, client_cmd_t *cmd)
+{
+    int ret = 0;
+    acq_loop_t loop = {
+        .session = session,
+        .cmd = cmd,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .filled = PTHREAD_COND_INITIALIZER,
+        .freed = PTHREAD_COND_INITIALIZER
+    };
+    uint32_t chan = cmd->acq_chan_list[0];
+    uint32_t num_chans = cmd->num_acq_chans;
+    uint64_t num_captures = cmd->acq_loop_call ? cmd->acq_loop_count :
+        (cmd->sw_sweep_call ? _sw_sweep_num_points (cmd) : 1);
+    sw_sweep_t sweep = {0};
+
+    /* Buffers fit the curve of any channel */
+    uint32_t data_size = 0;
+    for (uint32_t c = 0; c < num_chans; c++) {
+        uint32_t size = cmd->acq_total_samples_val*
+            client_lib_acq_sample_size (session->lib, cmd->acq_chan_list[c]);
+        data_size = (size > data_size) ? size : data_size;
+    }
+
+    for (uint32_t i = 0; i < ACQ_LOOP_NUM_BUFS; i++) {
+        loop.bufs[i].data = _acq_buf_get (session, data_size);
+        if (loop.bufs[i].data == NULL) {
+            ret = -1;
+            goto err_buf_alloc;
+        }
+    }
+
+    if (cmd->sw_sweep_call) {
+        if (_sw_sweep_init (session, &sweep) < 0) {
+            ret = -1;
+            goto err_buf_alloc;
+        }
+        loop.sweep = &sweep;
+    }
+
+    pthread_t writer;
+    if (pthread_create (&writer, NULL, _acq_loop_writer, &loop) != 0) {
+        fprintf (stderr, "[client:acq]: Could not start the writer thread\n");
+        ret = -1;
+        goto err_buf_alloc;
+    }
+
+    halcs_client_err_e err = HALCS_CLIENT_SUCCESS;
+    if (cmd->sw_sweep_call) {
+        err = _set_sw_delay (session, cmd, _sw_sweep_delay (cmd, 0));
+    }
+    int64_t start_ns = _realtime_ns ();
+    if (err == HALCS_CLIENT_SUCCESS) {
+        err = acq_start_chan (session, cmd, chan);
+    }
+    session->acq_start_ns = start_ns;
+
+    uint64_t capture_n = 0;
+    uint32_t chan_n = 0;
+    uint64_t num_rearms = 0;
+    int64_t dead_min = 0, dead_max = 0, dead_total = 0;
+
+    while (err == HALCS_CLIENT_SUCCESS && !zctx_interrupted) {
+        err = acq_wait_data (session, cmd);
+        if (err != HALCS_CLIENT_SUCCESS) {
+            break;
+        }
+        int64_t ready_ns = client_stats_now ();
+        int64_t timestamp_ns = _realtime_ns ();
+        session->acq_end_ns = timestamp_ns;
+
+        /* Wait for the writer to release a buffer. Stop as soon as it fails
+         * to write or analyse a capture */
+        pthread_mutex_lock (&loop.lock);
+        while (loop.count == ACQ_LOOP_NUM_BUFS && loop.err == 0) {
+            pthread_cond_wait (&loop.freed, &loop.lock);
+        }
+        acq_loop_buf_t *buf = &loop.bufs[loop.head];
+        int writer_err = loop.err;
+        pthread_mutex_unlock (&loop.lock);
+        if (writer_err < 0) {
+            break;
+        }
+
+        uint64_t bytes_read = 0;
+        err = client_lib_acq_fetch (session->lib, buf->data, data_size, &bytes_read);
+        if (err != HALCS_CLIENT_SUCCESS) {
+            break;
+        }
+
+        /* Do not re-arm if the previous capture could not be written */
+        pthread_mutex_lock (&loop.lock);
+        writer_err = loop.err;
+        pthread_mutex_unlock (&loop.lock);
+        if (writer_err < 0) {
+            break;
+        }
+
+        buf->start_ns = start_ns;
+        buf->chan = chan;
+        int last_chan = chan_n + 1 == num_chans;
+        int last = last_chan && num_captures != 0 && capture_n + 1 == num_captures;
+        if (!last) {
+            chan = cmd->acq_chan_list[last_chan ? 0 : chan_n + 1];
+            /* The sweep moves to the next delay before re-arming, so that
+             * this curve is analysed while the next one is acquired */
+            if (cmd->sw_sweep_call) {
+                err = _set_sw_delay (session, cmd, _sw_sweep_delay (cmd, capture_n + 1));
+            }
+            start_ns = _realtime_ns ();
+            if (err == HALCS_CLIENT_SUCCESS) {
+                err = acq_start_chan (session, cmd, chan);
+            }
+
+            int64_t dead_ns = client_stats_now () - ready_ns;
+            dead_min = (num_rearms == 0 || dead_ns < dead_min) ? dead_ns : dead_min;
+            dead_max = (num_rearms == 0 || dead_ns > dead_max) ? dead_ns : dead_max;
+            dead_total += dead_ns;
+            num_rearms++;
+            if (cmd->acq_loop_call && num_chans > 1) {
+                fprintf (stderr, "[client:acq]: Capture %" PRIu64 ", channel %u: dead time %.1f us\n",
+                        capture_n, buf->chan, dead_ns/1e3);
+            } else if (cmd->acq_loop_call) {
+                fprintf (stderr, "[client:acq]: Capture %" PRIu64 ": dead time %.1f us\n",
+                        capture_n, dead_ns/1e3);
+            }
+        }
+
+        buf->bytes = bytes_read;
+        buf->capture_n = capture_n;
+        buf->timestamp_ns = timestamp_ns;
+        if (last_chan) {
+            capture_n++;
+            chan_n = 0;
+        } else {
+            chan_n++;
+        }
+
+        pthread_mutex_lock (&loop.lock);
+        loop.head = (loop.head + 1) % ACQ_LOOP_NUM_BUFS;
+        loop.count++;
+        pthread_cond_signal (&loop.filled);
+        pthread_mutex_unlock (&loop.lock);
+
+        if (last) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock (&loop.lock);
+    loop.done = 1;
+    pthread_cond_signal (&loop.filled);
+    pthread_mutex_unlock (&loop.lock);
+    pthread_join (writer, NULL);
+
+    /* Interrupting an endless loop is the normal way to end it */
+    if (err != HALCS_CLIENT_SUCCESS && err != HALCS_CLIENT_INT) {
+        fprintf (stderr, "[client:acq]: %s\n", halcs_client_err_str (err));
+        ret = -1;
+    }
+    if (loop.err < 0) {
+        fprintf (stderr, "[client:acq]: Could not write the captures\n");
+        ret = -1;
+    }
+
+    /* Leave the board at the delay with the least ripple once every delay
+     * of the sweep was analysed */
+    if (ret == 0 && cmd->sw_sweep_call && sweep.num_points == _sw_sweep_num_points (cmd)) {
+        char line[80];
+        int len = snprintf (line, sizeof (line), "#swdly_optimal %u %f\n", sweep.best_delay,
+                sweep.best_ripple);
+        if (curve_fmt_write (&session->curve_out, line, len) < 0 ||
+                curve_fmt_flush (&session->curve_out) < 0) {
+            ret = -1;
+        }
+        err = _set_sw_delay (session, cmd, sweep.best_delay);
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: Could not set the optimal SW delay %u: %s\n",
+                    sweep.best_delay, halcs_client_err_str (err));
+            ret = -1;
+        }
+    } else if (cmd->sw_sweep_call) {
+        /* An unfinished sweep leaves the board as it found it */
+        err = _set_sw_delay (session, cmd, sweep.initial_delay);
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: Could not restore the SW delay %u: %s\n",
+                    sweep.initial_delay, halcs_client_err_str (err));
+            ret = -1;
+        }
+    }
+
+    if (num_rearms > 0) {
+        char chans[32] = "";
+        if (num_chans > 1) {
+            snprintf (chans, sizeof (chans), " of %u channels", num_chans);
+        }
+        fprintf (stderr, "[client:acq]: %" PRIu64 " captures%s, dead time min %.1f us, "
+                "avg %.1f us, max %.1f us\n", capture_n, chans, dead_min/1e3,
+                dead_total/1e3/num_rearms, dead_max/1e3);
+    }
+
+err_buf_alloc:
+    free (sweep.sums);
+    for (uint32_t i = 0; i < ACQ_LOOP_NUM_BUFS; i++) {
+        acq_buf_put (&session->buf_pool, loop.bufs[i].data);
+    }
+    return ret;
+}
+
+/* Read back the Kx, Ky and Ksum of the board into the --position gains */
+static int _read_pos_gains (client_session_t *session, const client_cmd_t *cmd)
+{
+    static const char *gain_names [3] = {
+        DSP_NAME_SET_GET_KX,
+        DSP_NAME_SET_GET_KY,
+        DSP_NAME_SET_GET_KSUM
+    };
+    uint32_t gains[3];
+
+    for (int i = 0; i < 3; i++) {
+        halcs_client_err_e err = client_lib_get (session->lib, DSP_MODULE_NAME, gain_names[i],
+                &gains[i], sizeof (gains[i]));
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: Could not read %s for --position: %s\n", gain_names[i],
+                    halcs_client_err_str (err));
+            return -1;
+        }
+    }
+
+    session->pos_gains.kx = gains[0]/pos_unit_nm[cmd->position_unit];
+    session->pos_gains.ky = gains[1]/pos_unit_nm[cmd->position_unit];
+    session->pos_gains.ksum = (double) gains[2]/CURVE_POS_KSUM_ONE;
+    PRINTV (session->out_fp, cmd->verbose, "[client:acq]: --position gains: Kx = %" PRIu32
+            " nm, Ky = %" PRIu32 " nm, Ksum = %" PRIu32 "\n", gains[0], gains[1], gains[2]);
+    return 0;
+}
+
+/* Run the functions and acquisition steps requested by cmd on the session
+ * connections. Returns 0 on success and -1 on failure */
+static int _client_cmd_exec_calls (client_session_t *session, client_cmd_t *cmd)
+{
+    int ret = 0;
+
+    if (cmd->monitor_rate > 0) {
+        return client_monitor_run (session, cmd);
+    }
+
+    /* Call all functions from the FMC130M_4CH, SWAP and DSP Module that the user specified */
+    if (cmd->pipeline_call) {
+        if (client_call_list_pipeline (session, cmd) < 0) {
+            return -1;
+        }
+    }
+    else {
+        call_func_t* function = (call_func_t *)zlist_first (cmd->call_list);
+
+        for ( ; function != NULL; function = zlist_next (cmd->call_list))
+        {
+            halcs_client_err_e err = client_lib_exec (session->lib, function->service,
+                    function->name, function->write_val, function->read_val);
+
+            if (err != HALCS_CLIENT_SUCCESS) {
+                fprintf (stderr, "[client]: %s\n",halcs_client_err_str (err));
+                return -1;
+            }
+
+            if (halcs_func_translate (function->name)->retval != DISP_ARG_END && function->rw) {
+                print_func_v(session->out_fp, 1, function);
+            }
+        }
+    }
+
+    /* After the calls, so that a --setkx in the same command is seen */
+    if (cmd->position_call && (cmd->acq_full_call || cmd->acq_get_curve_call || cmd->acq_get_block)) {
+        if (_read_pos_gains (session, cmd) < 0) {
+            return -1;
+        }
+    }
+
+    /***** Acquisition module routines *****/
+    /* Request data acquisition on server */
+    cmd->acq_total_samples_val = (cmd->acq_samples_pre_val+cmd->acq_samples_post_val)*cmd->acq_num_shots_val;
+    uint32_t data_size = cmd->acq_total_samples_val*
+        client_lib_acq_sample_size (session->lib, cmd->acq_chan_val);
+
+    if (cmd->acq_start_call) {
+        session->acq_start_ns = _realtime_ns ();
+        halcs_client_err_e err = acq_start_chan (session, cmd, cmd->acq_chan_val);
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: '%s'\n", halcs_client_err_str(err));
+            return -1;
+        }
+    } else {
+        /* The steps below refer to an acquisition started before */
+        halcs_client_err_e err = client_lib_acq_select (session->lib, cmd->acq_chan_val,
+                cmd->acq_samples_pre_val, cmd->acq_samples_post_val, cmd->acq_num_shots_val);
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: '%s'\n", halcs_client_err_str(err));
+            return -1;
+        }
+    }
+
+    /* Check if the previous acquisition has finished */
+    if (cmd->acq_check_call) {
+        halcs_client_err_e err;
+        if (cmd->check_poll) {
+            err = acq_wait_data (session, cmd);
+        } else {
+            err = client_lib_acq_check (session->lib);
+        }
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: '%s'\n", halcs_client_err_str(err));
+        } else {
+            session->acq_end_ns = _realtime_ns ();
+        }
+    }
+
+    /* Retrieve specific data block */
+    if (cmd->acq_get_block) {
+        uint32_t *valid_data = _acq_buf_get (session, data_size);
+        if (valid_data == NULL) {
+            return -1;
+        }
+
+        uint64_t bytes_read = 0;
+        halcs_client_err_e err = client_lib_acq_fetch_block (session->lib, cmd->acq_block_id,
+                valid_data, data_size, &bytes_read);
+
+        if (err == HALCS_CLIENT_SUCCESS) {
+            PRINTV (session->out_fp, cmd->verbose,
+                    "[client:acq]: halcs_get_block was successfully executed\n");
+            if (_write_curve (session, cmd, cmd->acq_chan_val, valid_data, bytes_read, 0, 0,
+                        0) < 0) {
+                ret = -1;
+            }
+        } else {
+            fprintf (stderr, "[client:acq]: halcs_get_block failed\n");
+            ret = -1;
+        }
+        acq_buf_put (&session->buf_pool, valid_data);
+    }
+
+    /* Returns a whole data curve, block by block */
+    if (cmd->acq_get_curve_call && cmd->acq_stream_call) {
+        halcs_client_err_e err = HALCS_CLIENT_SUCCESS;
+        if (_stream_curve (session, cmd, session->acq_start_ns, _realtime_ns (), &err) < 0) {
+            ret = -1;
+        }
+
+        if (err == HALCS_CLIENT_SUCCESS) {
+            PRINTV (session->out_fp, cmd->verbose,
+                    "[client:acq]: acq_stream_curve was successfully executed\n");
+        } else {
+            fprintf (stderr, "[client:acq]: acq_stream_curve failed: %s\n", halcs_client_err_str(err));
+            return -1;
+        }
+    }
+    /* Returns a whole data curve */
+    else if (cmd->acq_get_curve_call) {
+        uint32_t *valid_data = _acq_buf_get (session, data_size);
+        if (valid_data == NULL) {
+            return -1;
+        }
+
+        uint64_t bytes_read = 0;
+        halcs_client_err_e err = client_lib_acq_fetch (session->lib, valid_data, data_size,
+                &bytes_read);
+
+        if (err == HALCS_CLIENT_SUCCESS) {
+            if (_write_curve (session, cmd, cmd->acq_chan_val, valid_data, bytes_read, 0,
+                        session->acq_start_ns, _realtime_ns ()) < 0) {
+                ret = -1;
+            }
+            PRINTV (session->out_fp, cmd->verbose,
+                    "[client:acq]: acq_get_curve was successfully executed\n");
+        } else {
+            fprintf (stderr, "[client:acq]: acq_get_curve failed: %s\n", halcs_client_err_str(err));
+            acq_buf_put (&session->buf_pool, valid_data);
+            return -1;
+        }
+        acq_buf_put (&session->buf_pool, valid_data);
+    }
+
+    /* Perform full acquisitions back to back: repeated, over a channel list or
+     * over the SW delays of a sweep */
+    if (cmd->acq_full_call && (cmd->acq_loop_call || cmd->num_acq_chans > 1 || cmd->sw_sweep_call)) {
+        if (client_acq_loop_run (session, cmd) < 0) {
+            return -1;
+        }
+    }
+    /* Perform a full acquisition routine and stream the data curve */
+    else if (cmd->acq_full_call && cmd->acq_stream_call) {
+        int64_t start_ns = _realtime_ns ();
+        halcs_client_err_e err = acq_start_chan (session, cmd, cmd->acq_chan_val);
+        session->acq_start_ns = start_ns;
+        if (err == HALCS_CLIENT_SUCCESS) {
+            err = acq_wait_data (session, cmd);
+        }
+        if (err == HALCS_CLIENT_SUCCESS) {
+            session->acq_end_ns = _realtime_ns ();
+            if (_stream_curve (session, cmd, start_ns, session->acq_end_ns, &err) < 0) {
+                ret = -1;
+            }
+        }
+
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: %s\n", halcs_client_err_str(err));
+            return -1;
+        }
+    }
+    /* Perform a full acquisition routine and return a data curve */
+    else if (cmd->acq_full_call) {
+        uint32_t *valid_data = _acq_buf_get (session, data_size);
+        if (valid_data == NULL) {
+            return -1;
+        }
+
+        /* acq_full, with the adaptive completion wait */
+        uint64_t bytes_read = 0;
+        int64_t start = client_stats_now ();
+        int64_t start_ns = _realtime_ns ();
+        halcs_client_err_e err = acq_start_chan (session, cmd, cmd->acq_chan_val);
+        session->acq_start_ns = start_ns;
+        if (err == HALCS_CLIENT_SUCCESS) {
+            err = acq_wait_data (session, cmd);
+        }
+        if (err == HALCS_CLIENT_SUCCESS) {
+            session->acq_end_ns = _realtime_ns ();
+            err = client_lib_acq_fetch (session->lib, valid_data, data_size, &bytes_read);
+        }
+        client_stats_record (STATS_ACQ_FULL, start, bytes_read);
+
+        if (err != HALCS_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq]: %s\n", halcs_client_err_str(err));
+            acq_buf_put (&session->buf_pool, valid_data);
+            return -1;
+        }
+        if (_write_curve (session, cmd, cmd->acq_chan_val, valid_data, bytes_read, 0, start_ns,
+                    session->acq_end_ns) < 0) {
+            ret = -1;
+        }
+        acq_buf_put (&session->buf_pool, valid_data);
+    }
+
+    return ret;
+}
+
+/* Serializes the --hashfile appends of concurrent targets */
+static pthread_mutex_t hash_file_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int _report_hash (const client_cmd_t *cmd, const char *hex, uint64_t bytes)
+{
+    if (cmd->hash_file == NULL) {
+        fprintf (stderr, "[client:hash]: %u:%u %s %s %" PRIu64 "\n", cmd->board_number,
+                cmd->bpm_number, curve_hash_alg_name (cmd->hash_alg), hex, bytes);
+        return 0;
+    }
+
+    int err = 0;
+    pthread_mutex_lock (&hash_file_lock);
+    FILE *fp = fopen (cmd->hash_file, "a");
+    if (fp == NULL) {
+        fprintf (stderr, "[client:hash]: Could not open '%s'\n", cmd->hash_file);
+        err = -1;
+    } else {
+        fprintf (fp, "%u:%u %s %s %" PRIu64 "\n", cmd->board_number, cmd->bpm_number,
+                curve_hash_alg_name (cmd->hash_alg), hex, bytes);
+        if (fclose (fp) != 0) {
+            fprintf (stderr, "[client:hash]: Could not write '%s'\n", cmd->hash_file);
+            err = -1;
+        }
+    }
+    pthread_mutex_unlock (&hash_file_lock);
+    return err;
+}
+
+/* data_signature_method names of the metadata templates */
+static const char *signature_methods [END_CURVE_HASH] = {
+    [CURVE_HASH_NONE] = "none",
+    [CURVE_HASH_MD5] = "md5",
+    [CURVE_HASH_SHA1] = "sha-1",
+    [CURVE_HASH_SHA256] = "sha-256"
+};
+
+static curve_hash_alg_e _signature_method_alg (const char *method)
+{
+    char name[16] = "";
+    if (method != NULL) {
+        sscanf (method, "%15s", name);
+    }
+    for (int alg = CURVE_HASH_NONE+1; alg < END_CURVE_HASH; alg++) {
+        if (streq (name, signature_methods[alg])) {
+            return alg;
+        }
+    }
+    return CURVE_HASH_NONE;
+}
+
+/* ISO 8601 UTC timestamp with nanoseconds */
+static void _format_timestamp (char *str, size_t size, int64_t ns)
+{
+    time_t secs = ns / 1000000000;
+    struct tm tm;
+    gmtime_r (&secs, &tm);
+    size_t len = strftime (str, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf (str + len, size - len, ".%09dZ", (int) (ns % 1000000000));
+}
+
+static int _write_metadata (const client_session_t *session, const client_cmd_t *cmd,
+        acq_metadata_t *md, curve_hash_alg_e hash_alg, const char *hex)
+{
+    static const char *file_formats [END_FILE_FMT] = {
+        [TEXT] = "ascii",
+        [BINARY] = "binary",
+        [CONTAINER] = "container",
+        [COLUMNS] = "columns"
+    };
+    char timestamp[64];
+    int err = 0;
+
+    /* The template may be an earlier sidecar: drop what this command does
+     * not know */
+    if (session->acq_start_ns != 0) {
+        _format_timestamp (timestamp, sizeof (timestamp), session->acq_start_ns);
+        err |= acq_metadata_set (md, "timestamp_start", "%s", timestamp);
+    } else {
+        acq_metadata_unset (md, "timestamp_start");
+    }
+    if (session->acq_end_ns != 0) {
+        _format_timestamp (timestamp, sizeof (timestamp), session->acq_end_ns);
+        err |= acq_metadata_set (md, "timestamp_end", "%s", timestamp);
+    } else {
+        acq_metadata_unset (md, "timestamp_end");
+    }
+    if (hash_alg != CURVE_HASH_NONE) {
+        err |= acq_metadata_set (md, "data_signature_method", "%s", signature_methods[hash_alg]);
+        err |= acq_metadata_set (md, "data_signature", "%s", hex);
+    } else {
+        acq_metadata_unset (md, "data_signature");
+    }
+    const char *data_format = file_formats[cmd->filefmt_val];
+    if (cmd->reduce != REDUCE_NONE) {
+        data_format = reduce_names[cmd->reduce];
+    } else if (cmd->spectrum_call) {
+        data_format = "spectrum";
+    } else if (cmd->tune_call) {
+        data_format = "tune";
+    } else if (cmd->sw_sweep_call) {
+        data_format = "swsweep";
+    }
+    err |= acq_metadata_set (md, "data_file_format", "%s", data_format);
+    if (cmd->position_call) {
+        err |= acq_metadata_set (md, "data_position_unit", "%s", pos_unit_names[cmd->position_unit]);
+    } else {
+        acq_metadata_unset (md, "data_position_unit");
+    }
+    err |= acq_metadata_set (md, "acq_board", "%u", cmd->board_number);
+    err |= acq_metadata_set (md, "acq_bpm", "%u", cmd->bpm_number);
+    char chans[END_CHAN_ID*12] = "";
+    char sample_sizes[END_CHAN_ID*12] = "";
+    for (uint32_t i = 0, len = 0, size_len = 0; i < cmd->num_acq_chans; i++) {
+        uint32_t chan = cmd->acq_chan_list[i];
+        len += sprintf (chans + len, "%s%u", (i > 0) ? ", " : "", chan);
+        size_len += sprintf (sample_sizes + size_len, "%s%u", (i > 0) ? ", " : "",
+                client_lib_acq_sample_size (session->lib, chan));
+    }
+    err |= acq_metadata_set (md, "acq_channel", "%s", chans);
+    err |= acq_metadata_set (md, "acq_samples_pre", "%u", cmd->acq_samples_pre_val);
+    err |= acq_metadata_set (md, "acq_samples_post", "%u", cmd->acq_samples_post_val);
+    err |= acq_metadata_set (md, "acq_num_shots", "%u", cmd->acq_num_shots_val);
+    err |= acq_metadata_set (md, "acq_sample_size", "%s bytes", sample_sizes);
+
+    if (err != 0 || acq_metadata_write (md, cmd->metadata_file) < 0) {
+        fprintf (stderr, "[client:metadata]: Could not write '%s'\n", cmd->metadata_file);
+        return -1;
+    }
     return 0;
 }
+
+/* Leading number of a metadata value, 0 if it is missing or not a number */
+static double _metadata_number (const acq_metadata_t *md, const char *key)
+{
+    const char *value = acq_metadata_get (md, key);
+    return (value != NULL) ? strtod (value, NULL) : 0;
+}
+
+/* ADC sample rate of the --spectrum curves [Hz]: --acqrate, else the ADC
+ * clock of the metadata template, a harmonic of the beam revolution
+ * frequency, else the nominal one */
+static double _spectrum_rate (const client_cmd_t *cmd, const acq_metadata_t *md)
+{
+    if (cmd->acq_rate > 0) {
+        return cmd->acq_rate;
+    }
+
+    double carrier = _metadata_number (md, "signal_carrier_frequency");
+    double carrier_harmonic = _metadata_number (md, "signal_carrier_harmonic_number");
+    double adc_harmonic = _metadata_number (md, "adc_clock_sampling_harmonic");
+    if (carrier > 0 && carrier_harmonic > 0 && adc_harmonic > 0) {
+        double offset_ppm = _metadata_number (md, "adc_clock_sampling_offset");
+        return carrier/carrier_harmonic*adc_harmonic*(1 + offset_ppm*1e-6);
+    }
+    return ACQ_NOMINAL_ADC_CLK_HZ;
+}
+
+/* Execute a command, hashing its curve output and writing its metadata
+ * sidecar if requested */
+static int client_cmd_exec (client_session_t *session, client_cmd_t *cmd)
+{
+    curve_hash_alg_e hash_alg = cmd->hash_alg;
+    acq_metadata_t md;
+    acq_metadata_init (&md);
+
+    if (cmd->metadata_template != NULL) {
+        if (acq_metadata_load (&md, cmd->metadata_template) < 0) {
+            fprintf (stderr, "[client:metadata]: Could not read '%s'\n", cmd->metadata_template);
+            acq_metadata_destroy (&md);
+            return -1;
+        }
+        /* Sign the data as the template says, unless --hash is given */
+        if (hash_alg == CURVE_HASH_NONE) {
+            hash_alg = _signature_method_alg (acq_metadata_get (&md, "data_signature_method"));
+        }
+    }
+
+    client_lib_set_target (session->lib, cmd->board_number, cmd->bpm_number);
+    client_lib_acq_set_rate (session->lib, cmd->acq_rate);
+    session->acq_start_ns = 0;
+    session->acq_end_ns = 0;
+    session->spectrum_rate = _spectrum_rate (cmd, &md);
+    session->buf_pool.flags = cmd->acq_buf_flags;
+    if (session->fmt_pool.num_threads != cmd->fmt_threads) {
+        curve_fmt_pool_destroy (&session->fmt_pool);
+        curve_fmt_pool_init (&session->fmt_pool, cmd->fmt_threads);
+    }
+
+    curve_hash_t hash;
+    if (hash_alg != CURVE_HASH_NONE) {
+        curve_hash_init (&hash, hash_alg);
+        session->curve_out.hash = &hash;
+    }
+
+    int err = _client_cmd_exec_calls (session, cmd);
+
+    char hex[CURVE_HASH_MAX_HEX_SIZE] = "";
+    if (hash_alg != CURVE_HASH_NONE) {
+        /* Hash whatever is still buffered */
+        curve_fmt_flush (&session->curve_out);
+        session->curve_out.hash = NULL;
+
+        uint64_t bytes = hash.len;
+        curve_hash_final_hex (&hash, hex);
+        if (cmd->hash_alg != CURVE_HASH_NONE && _report_hash (cmd, hex, bytes) < 0) {
+            err = -1;
+        }
+    }
+
+    /* A failed command leaves no sidecar behind */
+    if (cmd->metadata_template != NULL && err == 0 &&
+            _write_metadata (session, cmd, &md, hash_alg, hex) < 0) {
+        err = -1;
+    }
+    acq_metadata_destroy (&md);
+    return err;
+}
+
+typedef struct {
+    uint32_t board_number;
+    uint32_t bpm_number;
+    zlist_t *call_list;
+    /* Written straight to stdout, as the targets before it were already
+     * written when it started */
+    int direct;
+    /* Otherwise, temporary file holding the target output until it is its
+     * turn to be written to stdout */
+    FILE *out_fp;
+    int err;
+    int done;
+} fanout_target_t;
+
+typedef struct {
+    client_cmd_t *cmd;
+    fanout_target_t *targets;
+    uint32_t num_targets;
+    uint32_t next_target;
+    /* Targets whose output is complete on stdout */
+    uint32_t num_written;
+    pthread_mutex_t lock;
+    pthread_cond_t target_done;
+} fanout_t;
+
+static zlist_t *_call_list_dup (zlist_t *call_list)
+{
+    zlist_t *dup = zlist_new ();
+    if (dup == NULL) {
+        return NULL;
+    }
+
+    call_func_t *function = (call_func_t *) zlist_first (call_list);
+    for ( ; function != NULL; function = zlist_next (call_list)) {
+        append_item (dup, *function);
+    }
+    return dup;
+}
+
+/* Each worker owns one session and runs targets until none is left */
+static void *_fanout_worker (void *arg)
+{
+    fanout_t *fanout = (fanout_t *) arg;
+    client_session_t session;
+    int session_err = client_session_open (&session, fanout->cmd->broker_endp,
+            fanout->cmd->verbose);
+
+    while (1) {
+        pthread_mutex_lock (&fanout->lock);
+        uint32_t i = fanout->next_target++;
+        int direct = (i == fanout->num_written);
+        pthread_mutex_unlock (&fanout->lock);
+        if (i >= fanout->num_targets) {
+            break;
+        }
+
+        fanout_target_t *target = &fanout->targets[i];
+        target->err = -1;
+        target->direct = direct;
+        if (direct) {
+            printf ("#target:%u:%u\n", target->board_number, target->bpm_number);
+        } else {
+            target->out_fp = tmpfile ();
+        }
+
+        if (!direct && target->out_fp == NULL) {
+            fprintf (stderr, "[client:fanout]: Could not create the output file of board %u, bpm %u\n",
+                    target->board_number, target->bpm_number);
+        } else if (session_err == 0 && !zctx_interrupted) {
+            /* Work on a private copy, as exec stores the read values in the
+             * call_list items */
+            client_cmd_t target_cmd = *fanout->cmd;
+            target_cmd.board_number = target->board_number;
+            target_cmd.bpm_number = target->bpm_number;
+            target_cmd.call_list = target->call_list;
+
+            if (!direct) {
+                client_session_set_output (&session, target->out_fp);
+            }
+            target->err = client_cmd_exec (&session, &target_cmd);
+            client_session_set_output (&session, stdout);
+        }
+
+        pthread_mutex_lock (&fanout->lock);
+        target->done = 1;
+        pthread_cond_broadcast (&fanout->target_done);
+        pthread_mutex_unlock (&fanout->lock);
+    }
+
+    if (session_err == 0) {
+        client_session_close (&session);
+    }
+    return NULL;
+}
+
+/* Run cmd against every board/bpm pair with a pool of at most cmd->num_jobs
+ * workers. The output of each target is written to stdout, in order: a
+ * target started once all the ones before it are written goes straight to
+ * stdout, the others are held in a temporary file until then */
+static int client_fanout_run (client_cmd_t *cmd)
+{
+    int failed = 0;
+    fanout_t fanout = {
+        .cmd = cmd,
+        .num_targets = cmd->num_boards*cmd->num_bpms
+    };
+
+    fanout.targets = zmalloc (fanout.num_targets*sizeof (fanout_target_t));
+    if (fanout.targets == NULL) {
+        fprintf (stderr, "[client:fanout]: Error in memory allocation for the targets\n");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < fanout.num_targets; i++) {
+        fanout.targets[i].board_number = cmd->board_list[i / cmd->num_bpms];
+        fanout.targets[i].bpm_number = cmd->bpm_list[i % cmd->num_bpms];
+        fanout.targets[i].call_list = _call_list_dup (cmd->call_list);
+    }
+
+    pthread_mutex_init (&fanout.lock, NULL);
+    pthread_cond_init (&fanout.target_done, NULL);
+
+    uint32_t num_workers = (cmd->num_jobs < fanout.num_targets) ? cmd->num_jobs : fanout.num_targets;
+    /* Share the formatting threads among the workers */
+    cmd->fmt_threads = (cmd->fmt_threads > num_workers) ? cmd->fmt_threads/num_workers : 1;
+    pthread_t *workers = zmalloc (num_workers*sizeof (pthread_t));
+    uint32_t num_started = 0;
+    for ( ; workers != NULL && num_started < num_workers; num_started++) {
+        if (pthread_create (&workers[num_started], NULL, _fanout_worker, &fanout) != 0) {
+            break;
+        }
+    }
+
+    if (num_started == 0) {
+        fprintf (stderr, "[client:fanout]: Could not start any worker\n");
+        /* Mark everything as failed without running it */
+        fanout.next_target = fanout.num_targets;
+        for (uint32_t i = 0; i < fanout.num_targets; i++) {
+            fanout.targets[i].err = -1;
+            fanout.targets[i].done = 1;
+        }
+    }
+
+    char copy_buf[1 << 16];
+    for (uint32_t i = 0; i < fanout.num_targets; i++) {
+        fanout_target_t *target = &fanout.targets[i];
+
+        pthread_mutex_lock (&fanout.lock);
+        while (!target->done) {
+            pthread_cond_wait (&fanout.target_done, &fanout.lock);
+        }
+        pthread_mutex_unlock (&fanout.lock);
+
+        int out_err = 0;
+        if (!target->direct) {
+            printf ("#target:%u:%u\n", target->board_number, target->bpm_number);
+        }
+        if (target->out_fp != NULL) {
+            size_t n;
+            rewind (target->out_fp);
+            while (out_err == 0 &&
+                    (n = fread (copy_buf, 1, sizeof (copy_buf), target->out_fp)) > 0) {
+                out_err = (fwrite (copy_buf, 1, n, stdout) != n);
+            }
+            out_err |= ferror (target->out_fp);
+            fclose (target->out_fp);
+        }
+        out_err |= fflush (stdout);
+        if (out_err) {
+            fprintf (stderr, "[client:fanout]: Could not write the output of board %u, bpm %u\n",
+                    target->board_number, target->bpm_number);
+            target->err = -1;
+        }
+        printf ("#target:%u:%u %s\n", target->board_number, target->bpm_number,
+                (target->err < 0) ? "failed" : "ok");
+        fflush (stdout);
+
+        pthread_mutex_lock (&fanout.lock);
+        fanout.num_written = i + 1;
+        pthread_mutex_unlock (&fanout.lock);
+
+        if (target->err < 0) {
+            failed++;
+        }
+        zlist_destroy (&target->call_list);
+    }
+
+    for (uint32_t i = 0; i < num_started; i++) {
+        pthread_join (workers[i], NULL);
+    }
+
+    free (workers);
+    pthread_cond_destroy (&fanout.target_done);
+    pthread_mutex_destroy (&fanout.lock);
+    free (fanout.targets);
+    return (failed > 0) ? -1 : 0;
+}
+
+/* Execute cmd on session, or on its own pool of sessions when it addresses
+ * more than one board/bpm */
+static int client_cmd_run (client_session_t *session, client_cmd_t *cmd)
+{
+    if (cmd->num_boards*cmd->num_bpms > 1) {
+        return client_fanout_run (cmd);
+    }
+    return client_cmd_exec (session, cmd);
+}
+
+/* Split line in place into whitespace separated arguments. Single or double
+ * quotes group words. Returns the number of arguments or -1 if there are
+ * more than max_args */
+static int _batch_split_line (char *line, char *args [], int max_args)
+{
+    int num_args = 0;
+    char *src = line;
+
+    while (1) {
+        while (*src == ' ' || *src == '\t' || *src == '\n' || *src == '\r') {
+            src++;
+        }
+        if (*src == '\0') {
+            break;
+        }
+        if (num_args == max_args) {
+            return -1;
+        }
+
+        /* Unquote into the same buffer, which never grows */
+        char *dst = src;
+        args[num_args++] = dst;
+        char quote = 0;
+        for ( ; *src != '\0'; src++) {
+            if (quote) {
+                if (*src == quote) {
+                    quote = 0;
+                    continue;
+                }
+            } else if (*src == '\'' || *src == '"') {
+                quote = *src;
+                continue;
+            } else if (*src == ' ' || *src == '\t' || *src == '\n' || *src == '\r') {
+                src++;
+                break;
+            }
+            *dst++ = *src;
+        }
+        *dst = '\0';
+    }
+
+    return num_args;
+}
+
+static char *_batch_number_str (uint32_t number)
+{
+    char number_str[16];
+    snprintf (number_str, sizeof (number_str), "%u", number);
+    return strdup (number_str);
+}
+
+/* Execute the commands of a batch file (or stdin, for "-"), one per line,
+ * over a single session. Lines take the same options as the command line.
+ * Board, BPM and endpoint default to the ones given along with --batch.
+ * Blank lines and lines starting with '#' are skipped. The output of each
+ * command is followed by a "#batch:<line> ok|failed" record on stdout */
+static int client_batch_run (client_cmd_t *defaults, const char *program_name)
+{
+    int ret = 0;
+    int failed = 0;
+    FILE *batch_fp = streq (defaults->batch_file, "-") ? stdin : fopen (defaults->batch_file, "r");
+    if (batch_fp == NULL) {
+        fprintf (stderr, "[client:batch]: Could not open '%s'\n", defaults->batch_file);
+        return -1;
+    }
+
+    client_session_t session;
+    if (client_session_open (&session, defaults->broker_endp, defaults->verbose) < 0) {
+        ret = -1;
+        goto err_session_open;
+    }
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    uint32_t line_n = 0;
+    while (!zctx_interrupted && getline (&line, &line_cap, batch_fp) != -1) {
+        char *args [BATCH_MAX_ARGS+1];
+        line_n++;
+
+        args[0] = (char *) program_name;
+        int num_args = _batch_split_line (line, args+1, BATCH_MAX_ARGS);
+        if (num_args == 0 || (num_args > 0 && args[1][0] == '#')) {
+            continue;
+        }
+
+        int err = -1;
+        client_cmd_t cmd;
+        client_cmd_init (&cmd);
+
+        if (num_args < 0) {
+            fprintf (stderr, "[client:batch]: Line %u has more than %u arguments\n",
+                    line_n, BATCH_MAX_ARGS);
+            goto cmd_done;
+        }
+
+        int parsed = client_cmd_parse (&cmd, program_name, num_args+1, args);
+        if (parsed == CLIENT_CMD_HELP) {
+            write_usage (program_name, stderr);
+        }
+        if (parsed != 0) {
+            goto cmd_done;
+        }
+
+        if (cmd.batch_file != NULL) {
+            fprintf (stderr, "[client:batch]: --batch can not be nested\n");
+            goto cmd_done;
+        }
+
+        if (cmd.broker_endp == NULL) {
+            cmd.broker_endp = strdup (defaults->broker_endp);
+        }
+        if (cmd.board_number_str == NULL) {
+            cmd.board_number_str = (defaults->board_number_str != NULL) ?
+                strdup (defaults->board_number_str) : _batch_number_str (defaults->board_number);
+        }
+        if (cmd.bpm_number_str == NULL) {
+            cmd.bpm_number_str = (defaults->bpm_number_str != NULL) ?
+                strdup (defaults->bpm_number_str) : _batch_number_str (defaults->bpm_number);
+        }
+
+        if (client_cmd_check (&cmd, program_name) < 0) {
+            goto cmd_done;
+        }
+
+        if (cmd.stats_call) {
+            client_stats_enable (cmd.stats_fmt);
+        }
+
+        /* Reconnect only if the line talks to another broker */
+        if (!streq (cmd.broker_endp, client_lib_broker_endp (session.lib))) {
+            client_session_close (&session);
+            if (client_session_open (&session, cmd.broker_endp, defaults->verbose) < 0) {
+                client_cmd_destroy (&cmd);
+                ret = -1;
+                goto err_session_reopen;
+            }
+        }
+
+        err = client_cmd_run (&session, &cmd);
+
+cmd_done:
+        if (err < 0) {
+            failed++;
+        }
+        fflush (stdout);
+        printf ("#batch:%u %s\n", line_n, (err < 0) ? "failed" : "ok");
+        fflush (stdout);
+        client_cmd_destroy (&cmd);
+    }
+
+    client_session_close (&session);
+
+err_session_reopen:
+    free (line);
+err_session_open:
+    if (batch_fp != stdin) {
+        fclose (batch_fp);
+    }
+    return (ret < 0 || failed > 0) ? -1 : 0;
+}
+
+int main (int argc, char *argv [])
+{
+    int err;
+    const char* program_name;
+    program_name = argv[0];
+
+    client_cmd_t cmd;
+    client_cmd_init (&cmd);
+
+    int parsed = client_cmd_parse (&cmd, program_name, argc, argv);
+    if (parsed == CLIENT_CMD_HELP) {
+        print_usage(program_name, stderr, 0);
+    } else if (parsed < 0) {
+        print_usage(program_name, stderr, 1);
+    }
+
+    if (client_cmd_check (&cmd, program_name) < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (cmd.stats_call) {
+        client_stats_enable (cmd.stats_fmt);
+    }
+
+    if (cmd.batch_file != NULL) {
+        err = client_batch_run (&cmd, program_name);
+    } else if (cmd.num_boards*cmd.num_bpms > 1) {
+        err = client_fanout_run (&cmd);
+    } else {
+        /* If we are here, all the parameters are good and the functions can be executed */
+        client_session_t session;
+        if (client_session_open (&session, cmd.broker_endp, cmd.verbose) < 0) {
+            exit(EXIT_FAILURE);
+        }
+
+        err = client_cmd_exec (&session, &cmd);
+        client_session_close (&session);
+    }
+
+    fflush (stdout);
+    client_stats_print (stderr);
+
+    /* Deallocate memory */
+    client_cmd_destroy (&cmd);
+    return (err < 0) ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <acq_client.h>
+#include "acq_stream.h"
+#include "acq_wait.h"
+#include "client_lib.h"
+#include "client_stats.h"
+
+/* Argument buffers of halcs_func_exec. The first word tells a read (1)
+ * from a write (0) and the value starts at word CLIENT_LIB_VALUE_WORD */
+#define CLIENT_LIB_ARGS_WORDS       32
+#define CLIENT_LIB_VALUE_WORD       4
+
+struct _client_lib_session_t {
+    char *broker_endp;
+    halcs_client_t *halcs_client;
+    acq_client_t *acq_client;
+    const acq_chan_t *acq_chan;
+    uint32_t board;
+    uint32_t bpm;
+    char acq_service[CLIENT_LIB_SERVICE_MAX_LEN];
+    /* Sample rate of the acquisition time estimates [Hz], 0 for nominal */
+    double acq_rate;
+    /* Last acquisition and its CLOCK_MONOTONIC start [ns], 0 if unknown */
+    acq_req_t acq_req;
+    int64_t acq_start_ns;
+    client_lib_acq_wait_info_t wait_info;
+};
+
+void client_lib_format_service (char *service, uint32_t board, const char *module, uint32_t bpm)
+{
+    snprintf (service, CLIENT_LIB_SERVICE_MAX_LEN, "HALCS%u:DEVIO:%s%u", board, module, bpm);
+}
+
+halcs_client_err_e client_lib_func_exec (halcs_client_t *halcs_client, const char *name,
+        char *service, uint32_t *write_val, uint32_t *read_val)
+{
+    const disp_op_t* func_structure = halcs_func_translate ((char *) name);
+    if (func_structure == NULL) {
+        return HALCS_CLIENT_ERR_INV_FUNCTION;
+    }
+
+    int64_t start = client_stats_now ();
+    halcs_client_err_e err = halcs_func_exec (halcs_client, func_structure, service,
+            write_val, read_val);
+    client_stats_record (STATS_FUNC_EXEC, start, 0);
+    return err;
+}
+
+client_lib_session_t *client_lib_open (const char *broker_endp, uint32_t board, uint32_t bpm,
+        int verbose)
+{
+    client_lib_session_t *session = calloc (1, sizeof (*session));
+    if (session == NULL) {
+        return NULL;
+    }
+
+    session->broker_endp = strdup (broker_endp);
+    client_lib_set_target (session, board, bpm);
+    if (session->broker_endp == NULL) {
+        goto err_alloc;
+    }
+
+    int64_t start = client_stats_now ();
+    session->halcs_client = halcs_client_new (session->broker_endp, verbose, NULL);
+    session->acq_client = acq_client_new (session->broker_endp, verbose, NULL);
+    client_stats_record (STATS_CONNECT, start, 0);
+    if (session->halcs_client == NULL || session->acq_client == NULL) {
+        goto err_alloc;
+    }
+    session->acq_chan = acq_get_chan (session->acq_client);
+    return session;
+
+err_alloc:
+    client_lib_close (session);
+    return NULL;
+}
+
+void client_lib_close (client_lib_session_t *session)
+{
+    if (session == NULL) {
+        return;
+    }
+    if (session->halcs_client != NULL) {
+        halcs_client_destroy (&session->halcs_client);
+    }
+    if (session->acq_client != NULL) {
+        acq_client_destroy (&session->acq_client);
+    }
+    free (session->broker_endp);
+    free (session);
+}
+
+void client_lib_set_target (client_lib_session_t *session, uint32_t board, uint32_t bpm)
+{
+    session->board = board;
+    session->bpm = bpm;
+    client_lib_format_service (session->acq_service, board, "ACQ", bpm);
+}
+
+const char *client_lib_broker_endp (const client_lib_session_t *session)
+{
+    return session->broker_endp;
+}
+
+const char *client_lib_err_str (int err)
+{
+    return halcs_client_err_str ((halcs_client_err_e) err);
+}
+
+int client_lib_exec (client_lib_session_t *session, const char *module, const char *name,
+        uint32_t *write_val, uint32_t *read_val)
+{
+    char service[CLIENT_LIB_SERVICE_MAX_LEN];
+    client_lib_format_service (service, session->board, module, session->bpm);
+    return client_lib_func_exec (session->halcs_client, name, service, write_val, read_val);
+}
+
+int client_lib_get (client_lib_session_t *session, const char *module, const char *name,
+        void *value, size_t size)
+{
+    uint32_t write_val[CLIENT_LIB_ARGS_WORDS] = {1};
+    uint32_t read_val[CLIENT_LIB_ARGS_WORDS] = {0};
+
+    if (size > sizeof (read_val)) {
+        return HALCS_CLIENT_ERR_INV_PARAM;
+    }
+
+    halcs_client_err_e err = client_lib_exec (session, module, name, write_val, read_val);
+    if (err == HALCS_CLIENT_SUCCESS) {
+        memcpy (value, read_val, size);
+    }
+    return err;
+}
+
+int client_lib_set (client_lib_session_t *session, const char *module, const char *name,
+        const void *value, size_t size)
+{
+    uint32_t write_val[CLIENT_LIB_ARGS_WORDS] = {0};
+    uint32_t read_val[CLIENT_LIB_ARGS_WORDS] = {0};
+
+    if (size > sizeof (write_val) - CLIENT_LIB_VALUE_WORD*sizeof (uint32_t)) {
+        return HALCS_CLIENT_ERR_INV_PARAM;
+    }
+    memcpy (write_val + CLIENT_LIB_VALUE_WORD, value, size);
+
+    return client_lib_exec (session, module, name, write_val, read_val);
+}
+
+uint32_t client_lib_acq_sample_size (const client_lib_session_t *session, uint32_t chan)
+{
+    if (chan >= END_CHAN_ID) {
+        return 0;
+    }
+    return session->acq_chan[chan].sample_size;
+}
+
+void client_lib_acq_set_rate (client_lib_session_t *session, double rate)
+{
+    session->acq_rate = rate;
+}
+
+int client_lib_acq_start (client_lib_session_t *session, uint32_t chan, uint32_t samples_pre,
+        uint32_t samples_post, uint32_t num_shots)
+{
+    acq_req_t acq_req = {
+        .num_samples_pre = samples_pre,
+        .num_samples_post = samples_post,
+        .num_shots = num_shots,
+        .chan = chan
+    };
+
+    if (chan >= END_CHAN_ID) {
+        return HALCS_CLIENT_ERR_INV_PARAM;
+    }
+
+    int64_t start = client_stats_now ();
+    halcs_client_err_e err = acq_start (session->acq_client, session->acq_service, &acq_req);
+    client_stats_record (STATS_ACQ_START, start, 0);
+    if (err == HALCS_CLIENT_SUCCESS) {
+        session->acq_req = acq_req;
+        session->acq_start_ns = start;
+    }
+    return err;
+}
+
+int client_lib_acq_select (client_lib_session_t *session, uint32_t chan, uint32_t samples_pre,
+        uint32_t samples_post, uint32_t num_shots)
+{
+    acq_req_t acq_req = {
+        .num_samples_pre = samples_pre,
+        .num_samples_post = samples_post,
+        .num_shots = num_shots,
+        .chan = chan
+    };
+
+    if (chan >= END_CHAN_ID) {
+        return HALCS_CLIENT_ERR_INV_PARAM;
+    }
+    session->acq_req = acq_req;
+    session->acq_start_ns = 0;
+    return HALCS_CLIENT_SUCCESS;
+}
+
+int64_t client_lib_acq_start_ns (const client_lib_session_t *session)
+{
+    return session->acq_start_ns;
+}
+
+int client_lib_acq_check (client_lib_session_t *session)
+{
+    int64_t start = client_stats_now ();
+    halcs_client_err_e err = acq_check (session->acq_client, session->acq_service);
+    client_stats_record (STATS_ACQ_CHECK, start, 0);
+    return err;
+}
+
+int client_lib_acq_wait (client_lib_session_t *session, int timeout)
+{
+    const acq_req_t *req = &session->acq_req;
+    acq_wait_cfg_t wait_cfg = {
+        .acq_client = session->acq_client,
+        .service = session->acq_service,
+        .start_ns = session->acq_start_ns,
+        .expected_ns = acq_wait_expected_ns (req->chan,
+                (uint64_t) (req->num_samples_pre + req->num_samples_post)*req->num_shots,
+                session->acq_rate),
+        .timeout = timeout
+    };
+    acq_wait_result_t result;
+
+    int64_t start = client_stats_now ();
+    halcs_client_err_e err = acq_wait_ready (&wait_cfg, &result);
+    client_stats_record (STATS_ACQ_WAIT, start, 0);
+    if (err == HALCS_CLIENT_SUCCESS) {
+        if (session->acq_start_ns != 0) {
+            client_stats_record (STATS_ACQ_READY, session->acq_start_ns, 0);
+        }
+        session->wait_info.expected_ns = wait_cfg.expected_ns;
+        session->wait_info.ready_ns = result.ready_ns;
+        session->wait_info.resolution_ns = result.resolution_ns;
+        session->wait_info.num_checks = result.num_checks;
+    }
+    return err;
+}
+
+void client_lib_acq_wait_info (const client_lib_session_t *session,
+        client_lib_acq_wait_info_t *info)
+{
+    *info = session->wait_info;
+}
+
+uint64_t client_lib_acq_curve_size (const client_lib_session_t *session)
+{
+    const acq_req_t *req = &session->acq_req;
+    return (uint64_t) (req->num_samples_pre + req->num_samples_post)*req->num_shots*
+        client_lib_acq_sample_size (session, req->chan);
+}
+
+int client_lib_acq_fetch (client_lib_session_t *session, void *buf, size_t size,
+        uint64_t *bytes_read)
+{
+    acq_trans_t acq_trans = {
+        .req = session->acq_req,
+        .block = {
+            .data = (uint32_t *) buf,
+            .data_size = (size < UINT32_MAX) ? (uint32_t) size : UINT32_MAX
+        }
+    };
+
+    int64_t start = client_stats_now ();
+    halcs_client_err_e err = acq_get_curve (session->acq_client, session->acq_service, &acq_trans);
+    client_stats_record (STATS_ACQ_CURVE, start, acq_trans.block.bytes_read);
+    if (bytes_read != NULL) {
+        *bytes_read = (err == HALCS_CLIENT_SUCCESS) ? acq_trans.block.bytes_read : 0;
+    }
+    return err;
+}
+
+int client_lib_acq_fetch_block (client_lib_session_t *session, uint32_t block_n, void *buf,
+        size_t size, uint64_t *bytes_read)
+{
+    acq_trans_t acq_trans = {
+        .req = session->acq_req,
+        .block = {
+            .idx = block_n,
+            .data = (uint32_t *) buf,
+            .data_size = (size < UINT32_MAX) ? (uint32_t) size : UINT32_MAX
+        }
+    };
+
+    int64_t start = client_stats_now ();
+    halcs_client_err_e err = acq_get_data_block (session->acq_client, session->acq_service,
+            &acq_trans);
+    client_stats_record (STATS_ACQ_BLOCK, start, acq_trans.block.bytes_read);
+    if (bytes_read != NULL) {
+        *bytes_read = (err == HALCS_CLIENT_SUCCESS) ? acq_trans.block.bytes_read : 0;
+    }
+    return err;
+}
+
+int client_lib_acq_stream (client_lib_session_t *session, unsigned num_bufs,
+        client_lib_block_fn *block_fn, void *ctx, uint64_t *bytes_streamed)
+{
+    acq_stream_cfg_t stream_cfg = {
+        .acq_client = session->acq_client,
+        .service = session->acq_service,
+        .chan = session->acq_req.chan,
+        .total_bytes = client_lib_acq_curve_size (session),
+        .num_bufs = num_bufs
+    };
+    uint64_t bytes = 0;
+
+    int64_t start = client_stats_now ();
+    halcs_client_err_e err = acq_stream_curve (&stream_cfg, block_fn, ctx, &bytes);
+    client_stats_record (STATS_ACQ_CURVE, start, bytes);
+    if (bytes_streamed != NULL) {
+        *bytes_streamed = bytes;
+    }
+    return err;
+}
@@ -0,0 +1,128 @@
+#ifndef _CLIENT_LIB_H_
+#define _CLIENT_LIB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <halcs_client.h>
+
+/* In-process access to one board/bpm, the part of the client that is not
+ * the command line: built into libclient_lib.so for other programs (e.g.
+ * through Python ctypes) and used by the client itself.
+ *
+ * All functions return a halcs_client_err_e, HALCS_CLIENT_SUCCESS (0) on
+ * success, unless stated otherwise. A session is not thread safe */
+
+/* Service names are "HALCS<board>:DEVIO:<module><bpm>" */
+#define CLIENT_LIB_SERVICE_MAX_LEN  64
+
+typedef struct _client_lib_session_t client_lib_session_t;
+
+/* Connect to the broker at broker_endp and address board, bpm. NULL if
+ * the connection could not be set up */
+client_lib_session_t *client_lib_open (const char *broker_endp, uint32_t board, uint32_t bpm,
+        int verbose);
+void client_lib_close (client_lib_session_t *session);
+
+/* Address board, bpm over the connections of session from now on */
+void client_lib_set_target (client_lib_session_t *session, uint32_t board, uint32_t bpm);
+
+/* Broker endpoint of session */
+const char *client_lib_broker_endp (const client_lib_session_t *session);
+
+/* Description of an error code */
+const char *client_lib_err_str (int err);
+
+/* Read the value of the function called name (as known by
+ * halcs_func_translate, e.g. "dsp_kx") of module (e.g. "DSP"). size bytes
+ * are copied to value: 2, 4 or 8 for uint16, uint32 and uint64 values, 8
+ * for doubles */
+int client_lib_get (client_lib_session_t *session, const char *module, const char *name,
+        void *value, size_t size);
+
+/* Write the size bytes at value with the function called name of module */
+int client_lib_set (client_lib_session_t *session, const char *module, const char *name,
+        const void *value, size_t size);
+
+/* Execute the function called name of module with the raw argument words
+ * of halcs_func_exec: write_val[0] is 1 for a read and 0 for a write and
+ * the arguments start at word 4. The value read is left in read_val. Both
+ * hold at least 32 words */
+int client_lib_exec (client_lib_session_t *session, const char *module, const char *name,
+        uint32_t *write_val, uint32_t *read_val);
+
+/* Size in bytes of a sample of chan, 0 if there is no such channel */
+uint32_t client_lib_acq_sample_size (const client_lib_session_t *session, uint32_t chan);
+
+/* Sample rate [Hz] the acquisition times are estimated from, which sets
+ * how client_lib_acq_wait paces its checks. 0, the default, is the
+ * nominal rate of each channel */
+void client_lib_acq_set_rate (client_lib_session_t *session, double rate);
+
+/* Start an acquisition of num_shots shots of samples_pre + samples_post
+ * samples of chan. HALCS_CLIENT_ERR_INV_PARAM if there is no such
+ * channel */
+int client_lib_acq_start (client_lib_session_t *session, uint32_t chan, uint32_t samples_pre,
+        uint32_t samples_post, uint32_t num_shots);
+
+/* Refer the calls below to an acquisition of chan that was not started by
+ * this session, e.g. by another process. Its start time is unknown.
+ * HALCS_CLIENT_ERR_INV_PARAM if there is no such channel */
+int client_lib_acq_select (client_lib_session_t *session, uint32_t chan, uint32_t samples_pre,
+        uint32_t samples_post, uint32_t num_shots);
+
+/* CLOCK_MONOTONIC [ns] of the start of the last acquisition, 0 if unknown */
+int64_t client_lib_acq_start_ns (const client_lib_session_t *session);
+
+/* Check once whether the acquisition is over. HALCS_CLIENT_SUCCESS if it
+ * is */
+int client_lib_acq_check (client_lib_session_t *session);
+
+/* Wait up to timeout ms (-1 for no limit) for the acquisition to be over */
+int client_lib_acq_wait (client_lib_session_t *session, int timeout);
+
+/* How the last successful client_lib_acq_wait went [ns] */
+typedef struct {
+    /* Expected time from the start until the data is ready, 0 if unknown */
+    int64_t expected_ns;
+    /* From the start (or from the call, if the start is unknown) to the
+     * check that found the data ready */
+    int64_t ready_ns;
+    /* The data became ready at most this long before it was seen */
+    int64_t resolution_ns;
+    uint32_t num_checks;
+} client_lib_acq_wait_info_t;
+
+void client_lib_acq_wait_info (const client_lib_session_t *session,
+        client_lib_acq_wait_info_t *info);
+
+/* Size in bytes of the curve of the last acquisition started */
+uint64_t client_lib_acq_curve_size (const client_lib_session_t *session);
+
+/* Transfer the curve of the last acquisition straight into buf, of size
+ * bytes. The number of bytes read is stored in *bytes_read */
+int client_lib_acq_fetch (client_lib_session_t *session, void *buf, size_t size,
+        uint64_t *bytes_read);
+
+/* Transfer block block_n of the curve of the last acquisition into buf, of
+ * size bytes */
+int client_lib_acq_fetch_block (client_lib_session_t *session, uint32_t block_n, void *buf,
+        size_t size, uint64_t *bytes_read);
+
+/* Called, in order, for every block of a streamed curve. A non-zero return
+ * value aborts the stream */
+typedef int (client_lib_block_fn) (void *ctx, uint32_t *data, uint32_t size);
+
+/* Transfer the curve of the last acquisition block by block through
+ * num_bufs block buffers, handing each block to block_fn while the next
+ * ones are transferred. The number of bytes handed over is stored in
+ * *bytes_streamed */
+int client_lib_acq_stream (client_lib_session_t *session, unsigned num_bufs,
+        client_lib_block_fn *block_fn, void *ctx, uint64_t *bytes_streamed);
+
+/* Building blocks shared with the client */
+void client_lib_format_service (char *service, uint32_t board, const char *module, uint32_t bpm);
+halcs_client_err_e client_lib_func_exec (halcs_client_t *halcs_client, const char *name,
+        char *service, uint32_t *write_val, uint32_t *read_val);
+
+#endif
@@ -0,0 +1,184 @@
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include "client_stats.h"
+
+/* Latencies are kept in logarithmic buckets, with 4 sub-buckets per power of
+ * two, so quantiles are accurate to about 12% over the whole int64 range */
+#define STATS_SUB_BUCKETS_LOG2      2
+#define STATS_SUB_BUCKETS           (1 << STATS_SUB_BUCKETS_LOG2)
+#define STATS_NUM_BUCKETS           (64*STATS_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t count;
+    uint64_t bytes;
+    int64_t total_ns;
+    int64_t min_ns;
+    int64_t max_ns;
+    uint64_t buckets[STATS_NUM_BUCKETS];
+} stats_hist_t;
+
+static const char *stats_names[END_STATS_ID] = {
+    [STATS_CONNECT]     = "connect",
+    [STATS_FUNC_EXEC]   = "func_exec",
+    [STATS_ACQ_START]   = "acq_start",
+    [STATS_ACQ_CHECK]   = "acq_check",
+    [STATS_ACQ_WAIT]    = "acq_wait",
+    [STATS_ACQ_READY]   = "acq_ready",
+    [STATS_ACQ_BLOCK]   = "acq_get_block",
+    [STATS_ACQ_CURVE]   = "acq_get_curve",
+    [STATS_ACQ_FULL]    = "acq_full",
+    [STATS_OUTPUT]      = "output",
+};
+
+static struct {
+    int enabled;
+    stats_fmt_e fmt;
+    int64_t start_ns;
+    pthread_mutex_t lock;
+    stats_hist_t hists[END_STATS_ID];
+} stats = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static unsigned _bucket_idx (int64_t ns)
+{
+    uint64_t v = (ns > 0) ? (uint64_t) ns : 0;
+    if (v < STATS_SUB_BUCKETS) {
+        return v;
+    }
+
+    unsigned exp = 63 - __builtin_clzll (v);
+    unsigned sub = (v >> (exp - STATS_SUB_BUCKETS_LOG2)) & (STATS_SUB_BUCKETS - 1);
+    return (exp - STATS_SUB_BUCKETS_LOG2 + 1)*STATS_SUB_BUCKETS + sub;
+}
+
+/* Middle of the values mapped to bucket idx */
+static int64_t _bucket_value (unsigned idx)
+{
+    if (idx < STATS_SUB_BUCKETS) {
+        return idx;
+    }
+
+    unsigned exp = idx/STATS_SUB_BUCKETS + STATS_SUB_BUCKETS_LOG2 - 1;
+    unsigned sub = idx % STATS_SUB_BUCKETS;
+    uint64_t width = 1ULL << (exp - STATS_SUB_BUCKETS_LOG2);
+    return (STATS_SUB_BUCKETS + sub)*width + width/2;
+}
+
+static int64_t _quantile (const stats_hist_t *hist, double q)
+{
+    uint64_t rank = (uint64_t) (q*(hist->count - 1)) + 1;
+    uint64_t seen = 0;
+
+    for (unsigned idx = 0; idx < STATS_NUM_BUCKETS; idx++) {
+        seen += hist->buckets[idx];
+        if (seen >= rank) {
+            int64_t value = _bucket_value (idx);
+            value = (value < hist->min_ns) ? hist->min_ns : value;
+            return (value > hist->max_ns) ? hist->max_ns : value;
+        }
+    }
+    return hist->max_ns;
+}
+
+void client_stats_enable (stats_fmt_e fmt)
+{
+    pthread_mutex_lock (&stats.lock);
+    if (!stats.enabled) {
+        stats.start_ns = client_stats_now ();
+    }
+    stats.enabled = 1;
+    stats.fmt = fmt;
+    pthread_mutex_unlock (&stats.lock);
+}
+
+int client_stats_enabled (void)
+{
+    return stats.enabled;
+}
+
+int64_t client_stats_now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+void client_stats_record (stats_id_e id, int64_t start_ns, uint64_t bytes)
+{
+    if (!stats.enabled || id >= END_STATS_ID) {
+        return;
+    }
+
+    int64_t elapsed = client_stats_now () - start_ns;
+    stats_hist_t *hist = &stats.hists[id];
+
+    pthread_mutex_lock (&stats.lock);
+    if (hist->count == 0 || elapsed < hist->min_ns) {
+        hist->min_ns = elapsed;
+    }
+    if (hist->count == 0 || elapsed > hist->max_ns) {
+        hist->max_ns = elapsed;
+    }
+    hist->count++;
+    hist->bytes += bytes;
+    hist->total_ns += elapsed;
+    hist->buckets[_bucket_idx (elapsed)]++;
+    pthread_mutex_unlock (&stats.lock);
+}
+
+static double _throughput (const stats_hist_t *hist)
+{
+    return (hist->total_ns > 0) ? hist->bytes*1e9/hist->total_ns : 0.0;
+}
+
+void client_stats_print (FILE *fp)
+{
+    if (!stats.enabled) {
+        return;
+    }
+
+    pthread_mutex_lock (&stats.lock);
+    int64_t wall_ns = client_stats_now () - stats.start_ns;
+
+    if (stats.fmt == STATS_FMT_JSON) {
+        const char *sep = "";
+        fprintf (fp, "{\"wall_ns\": %" PRId64 ", \"phases\": {", wall_ns);
+        for (unsigned id = 0; id < END_STATS_ID; id++) {
+            const stats_hist_t *hist = &stats.hists[id];
+            if (hist->count == 0) {
+                continue;
+            }
+            fprintf (fp, "%s\"%s\": {\"count\": %" PRIu64 ", \"total_ns\": %" PRId64
+                    ", \"min_ns\": %" PRId64 ", \"p50_ns\": %" PRId64 ", \"p99_ns\": %" PRId64
+                    ", \"max_ns\": %" PRId64 ", \"bytes\": %" PRIu64 ", \"bytes_per_s\": %.0f}",
+                    sep, stats_names[id], hist->count, hist->total_ns, hist->min_ns,
+                    _quantile (hist, 0.5), _quantile (hist, 0.99), hist->max_ns, hist->bytes,
+                    _throughput (hist));
+            sep = ", ";
+        }
+        fprintf (fp, "}}\n");
+    }
+    else {
+        fprintf (fp, "[client:stats]: wall time %.3f ms\n", wall_ns/1e6);
+        fprintf (fp, "[client:stats]: %-14s %8s %12s %12s %12s %12s %12s\n", "phase", "count",
+                "total [ms]", "p50 [us]", "p99 [us]", "max [us]", "MB/s");
+        for (unsigned id = 0; id < END_STATS_ID; id++) {
+            const stats_hist_t *hist = &stats.hists[id];
+            if (hist->count == 0) {
+                continue;
+            }
+            fprintf (fp, "[client:stats]: %-14s %8" PRIu64 " %12.3f %12.1f %12.1f %12.1f",
+                    stats_names[id], hist->count, hist->total_ns/1e6, _quantile (hist, 0.5)/1e3,
+                    _quantile (hist, 0.99)/1e3, hist->max_ns/1e3);
+            if (hist->bytes > 0) {
+                fprintf (fp, " %12.3f\n", _throughput (hist)/1e6);
+            } else {
+                fprintf (fp, " %12s\n", "-");
+            }
+        }
+    }
+    pthread_mutex_unlock (&stats.lock);
+}
@@ -0,0 +1,42 @@
+#ifndef _CLIENT_STATS_H_
+#define _CLIENT_STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Timed phases and remote calls */
+typedef enum {
+    STATS_CONNECT = 0,      /* halcs_client_new/acq_client_new */
+    STATS_FUNC_EXEC,        /* Every halcs_func_exec */
+    STATS_ACQ_START,        /* acq_start */
+    STATS_ACQ_CHECK,        /* Single acq_check */
+    STATS_ACQ_WAIT,         /* Polling until the acquisition is over */
+    STATS_ACQ_READY,        /* From acq_start until the data is seen ready */
+    STATS_ACQ_BLOCK,        /* acq_get_data_block */
+    STATS_ACQ_CURVE,        /* acq_get_curve or a whole stream */
+    STATS_ACQ_FULL,         /* acq_full */
+    STATS_OUTPUT,           /* print_data_curve */
+    END_STATS_ID
+} stats_id_e;
+
+typedef enum {
+    STATS_FMT_TEXT = 0,
+    STATS_FMT_JSON,
+    END_STATS_FMT
+} stats_fmt_e;
+
+/* Start recording. Until then, client_stats_record does nothing */
+void client_stats_enable (stats_fmt_e fmt);
+int client_stats_enabled (void);
+
+/* CLOCK_MONOTONIC timestamp [ns] */
+int64_t client_stats_now (void);
+
+/* Account one occurrence of id that started at start_ns and ends now,
+ * moving bytes of data. Safe to call from any thread */
+void client_stats_record (stats_id_e id, int64_t start_ns, uint64_t bytes);
+
+/* Print count, p50/p99/max latency and throughput of every phase seen */
+void client_stats_print (FILE *fp);
+
+#endif
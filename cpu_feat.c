@@ -0,0 +1,15 @@
+#include "cpu_feat.h"
+
+int cpu_has_avx2 (void)
+{
+#ifdef CPU_FEAT_AVX2
+    static int has_avx2 = -1;
+    if (has_avx2 < 0) {
+        __builtin_cpu_init ();
+        has_avx2 = __builtin_cpu_supports ("avx2") ? 1 : 0;
+    }
+    return has_avx2;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,17 @@
+#ifndef _CPU_FEAT_H_
+#define _CPU_FEAT_H_
+
+/* CPU features the curve kernels dispatch on at run time.
+ *
+ * CPU_FEAT_AVX2 is defined where the compiler builds AVX2 functions (marked
+ * __attribute__ ((target ("avx2")))) whatever the target flags. They must
+ * only be called if cpu_has_avx2 () */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(__INTEL_COMPILER)
+#define CPU_FEAT_AVX2
+#endif
+
+/* 1 if the CPU runs AVX2 instructions, 0 otherwise. The answer is cached
+ * after the first call */
+int cpu_has_avx2 (void);
+
+#endif
@@ -0,0 +1,196 @@
+#include "curve_deint.h"
+#include "cpu_feat.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define CURVE_DEINT_SSE2
+#include <emmintrin.h>
+#ifdef CPU_FEAT_AVX2
+#define CURVE_DEINT_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+/* Lane values from row i on */
+static void _deint_i16x4_tail (int16_t *dst, const int16_t *data, size_t rows, size_t i)
+{
+    for ( ; i < rows; i++) {
+        dst[i] = data[4*i];
+        dst[rows + i] = data[4*i + 1];
+        dst[2*rows + i] = data[4*i + 2];
+        dst[3*rows + i] = data[4*i + 3];
+    }
+}
+
+static void _deint_i32x4_tail (int32_t *dst, const int32_t *data, size_t rows, size_t i)
+{
+    for ( ; i < rows; i++) {
+        dst[i] = data[4*i];
+        dst[rows + i] = data[4*i + 1];
+        dst[2*rows + i] = data[4*i + 2];
+        dst[3*rows + i] = data[4*i + 3];
+    }
+}
+
+void curve_deint_i16x4_scalar (int16_t *dst, const int16_t *data, size_t rows)
+{
+    _deint_i16x4_tail (dst, data, rows, 0);
+}
+
+void curve_deint_i32x4_scalar (int32_t *dst, const int32_t *data, size_t rows)
+{
+    _deint_i32x4_tail (dst, data, rows, 0);
+}
+
+#ifdef CURVE_DEINT_SSE2
+/* 8 rows at a time: two rows per register, interleaved 16 then 32 bit
+ * wise and split into columns 64 bit wise */
+static void _deint_i16x4_sse2 (int16_t *dst, const int16_t *data, size_t rows)
+{
+    size_t i = 0;
+    for ( ; i + 8 <= rows; i += 8) {
+        const __m128i *src = (const __m128i *) (data + 4*i);
+        __m128i v0 = _mm_loadu_si128 (src);
+        __m128i v1 = _mm_loadu_si128 (src + 1);
+        __m128i v2 = _mm_loadu_si128 (src + 2);
+        __m128i v3 = _mm_loadu_si128 (src + 3);
+
+        __m128i t0 = _mm_unpacklo_epi16 (v0, v1);
+        __m128i t1 = _mm_unpackhi_epi16 (v0, v1);
+        __m128i t2 = _mm_unpacklo_epi16 (v2, v3);
+        __m128i t3 = _mm_unpackhi_epi16 (v2, v3);
+        /* A and B of rows 0-3, C and D of rows 0-3, then rows 4-7 */
+        __m128i u0 = _mm_unpacklo_epi16 (t0, t1);
+        __m128i u1 = _mm_unpackhi_epi16 (t0, t1);
+        __m128i u2 = _mm_unpacklo_epi16 (t2, t3);
+        __m128i u3 = _mm_unpackhi_epi16 (t2, t3);
+
+        _mm_storeu_si128 ((__m128i *) (dst + i), _mm_unpacklo_epi64 (u0, u2));
+        _mm_storeu_si128 ((__m128i *) (dst + rows + i), _mm_unpackhi_epi64 (u0, u2));
+        _mm_storeu_si128 ((__m128i *) (dst + 2*rows + i), _mm_unpacklo_epi64 (u1, u3));
+        _mm_storeu_si128 ((__m128i *) (dst + 3*rows + i), _mm_unpackhi_epi64 (u1, u3));
+    }
+    _deint_i16x4_tail (dst, data, rows, i);
+}
+
+/* 4x4 transpose of 4 rows */
+static void _deint_i32x4_sse2 (int32_t *dst, const int32_t *data, size_t rows)
+{
+    size_t i = 0;
+    for ( ; i + 4 <= rows; i += 4) {
+        const __m128i *src = (const __m128i *) (data + 4*i);
+        __m128i v0 = _mm_loadu_si128 (src);
+        __m128i v1 = _mm_loadu_si128 (src + 1);
+        __m128i v2 = _mm_loadu_si128 (src + 2);
+        __m128i v3 = _mm_loadu_si128 (src + 3);
+
+        __m128i t0 = _mm_unpacklo_epi32 (v0, v1);
+        __m128i t1 = _mm_unpackhi_epi32 (v0, v1);
+        __m128i t2 = _mm_unpacklo_epi32 (v2, v3);
+        __m128i t3 = _mm_unpackhi_epi32 (v2, v3);
+
+        _mm_storeu_si128 ((__m128i *) (dst + i), _mm_unpacklo_epi64 (t0, t2));
+        _mm_storeu_si128 ((__m128i *) (dst + rows + i), _mm_unpackhi_epi64 (t0, t2));
+        _mm_storeu_si128 ((__m128i *) (dst + 2*rows + i), _mm_unpacklo_epi64 (t1, t3));
+        _mm_storeu_si128 ((__m128i *) (dst + 3*rows + i), _mm_unpackhi_epi64 (t1, t3));
+    }
+    _deint_i32x4_tail (dst, data, rows, i);
+}
+#endif
+
+#ifdef CURVE_DEINT_AVX2
+/* The SSE2 shuffles on both 128 bit halves, which leaves each column
+ * ordered as rows 0 1 4 5 8 9 12 13 | 2 3 6 7 10 11 14 15 (16 bit) or
+ * 0 2 4 6 | 1 3 5 7 (32 bit), and a cross-half permutation of 32 bit
+ * words to restore the row order */
+__attribute__ ((target ("avx2")))
+static void _deint_i16x4_avx2 (int16_t *dst, const int16_t *data, size_t rows)
+{
+    const __m256i order = _mm256_setr_epi32 (0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for ( ; i + 16 <= rows; i += 16) {
+        const __m256i *src = (const __m256i *) (data + 4*i);
+        __m256i v0 = _mm256_loadu_si256 (src);
+        __m256i v1 = _mm256_loadu_si256 (src + 1);
+        __m256i v2 = _mm256_loadu_si256 (src + 2);
+        __m256i v3 = _mm256_loadu_si256 (src + 3);
+
+        __m256i t0 = _mm256_unpacklo_epi16 (v0, v1);
+        __m256i t1 = _mm256_unpackhi_epi16 (v0, v1);
+        __m256i t2 = _mm256_unpacklo_epi16 (v2, v3);
+        __m256i t3 = _mm256_unpackhi_epi16 (v2, v3);
+        __m256i u0 = _mm256_unpacklo_epi16 (t0, t1);
+        __m256i u1 = _mm256_unpackhi_epi16 (t0, t1);
+        __m256i u2 = _mm256_unpacklo_epi16 (t2, t3);
+        __m256i u3 = _mm256_unpackhi_epi16 (t2, t3);
+
+        _mm256_storeu_si256 ((__m256i *) (dst + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpacklo_epi64 (u0, u2), order));
+        _mm256_storeu_si256 ((__m256i *) (dst + rows + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpackhi_epi64 (u0, u2), order));
+        _mm256_storeu_si256 ((__m256i *) (dst + 2*rows + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpacklo_epi64 (u1, u3), order));
+        _mm256_storeu_si256 ((__m256i *) (dst + 3*rows + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpackhi_epi64 (u1, u3), order));
+    }
+    _deint_i16x4_tail (dst, data, rows, i);
+}
+
+__attribute__ ((target ("avx2")))
+static void _deint_i32x4_avx2 (int32_t *dst, const int32_t *data, size_t rows)
+{
+    const __m256i order = _mm256_setr_epi32 (0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for ( ; i + 8 <= rows; i += 8) {
+        const __m256i *src = (const __m256i *) (data + 4*i);
+        __m256i v0 = _mm256_loadu_si256 (src);
+        __m256i v1 = _mm256_loadu_si256 (src + 1);
+        __m256i v2 = _mm256_loadu_si256 (src + 2);
+        __m256i v3 = _mm256_loadu_si256 (src + 3);
+
+        __m256i t0 = _mm256_unpacklo_epi32 (v0, v1);
+        __m256i t1 = _mm256_unpackhi_epi32 (v0, v1);
+        __m256i t2 = _mm256_unpacklo_epi32 (v2, v3);
+        __m256i t3 = _mm256_unpackhi_epi32 (v2, v3);
+
+        _mm256_storeu_si256 ((__m256i *) (dst + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpacklo_epi64 (t0, t2), order));
+        _mm256_storeu_si256 ((__m256i *) (dst + rows + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpackhi_epi64 (t0, t2), order));
+        _mm256_storeu_si256 ((__m256i *) (dst + 2*rows + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpacklo_epi64 (t1, t3), order));
+        _mm256_storeu_si256 ((__m256i *) (dst + 3*rows + i),
+                _mm256_permutevar8x32_epi32 (_mm256_unpackhi_epi64 (t1, t3), order));
+    }
+    _deint_i32x4_tail (dst, data, rows, i);
+}
+#endif
+
+void curve_deint_i16x4 (int16_t *dst, const int16_t *data, size_t rows)
+{
+#if defined(CURVE_DEINT_AVX2)
+    if (cpu_has_avx2 ()) {
+        _deint_i16x4_avx2 (dst, data, rows);
+        return;
+    }
+#endif
+#if defined(CURVE_DEINT_SSE2)
+    _deint_i16x4_sse2 (dst, data, rows);
+#else
+    _deint_i16x4_tail (dst, data, rows, 0);
+#endif
+}
+
+void curve_deint_i32x4 (int32_t *dst, const int32_t *data, size_t rows)
+{
+#if defined(CURVE_DEINT_AVX2)
+    if (cpu_has_avx2 ()) {
+        _deint_i32x4_avx2 (dst, data, rows);
+        return;
+    }
+#endif
+#if defined(CURVE_DEINT_SSE2)
+    _deint_i32x4_sse2 (dst, data, rows);
+#else
+    _deint_i32x4_tail (dst, data, rows, 0);
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef _CURVE_DEINT_H_
+#define _CURVE_DEINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Split rows of 4 interleaved lanes (A, B, C, D) into 4 contiguous
+ * columns: dst holds the rows values of lane A, then those of lane B, C
+ * and D, so dst[l*rows + i] = data[4*i + l]. dst and data must not
+ * overlap. SSE2 and, where the CPU has it, AVX2 shuffles are used on x86,
+ * plain loops elsewhere */
+void curve_deint_i16x4 (int16_t *dst, const int16_t *data, size_t rows);
+void curve_deint_i32x4 (int32_t *dst, const int32_t *data, size_t rows);
+
+/* Same, always with plain loops */
+void curve_deint_i16x4_scalar (int16_t *dst, const int16_t *data, size_t rows);
+void curve_deint_i32x4_scalar (int32_t *dst, const int32_t *data, size_t rows);
+
+#endif
@@ -0,0 +1,175 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "curve_fft.h"
+#include "cpu_feat.h"
+
+#ifdef CPU_FEAT_AVX2
+#define CURVE_FFT_AVX2
+#include <immintrin.h>
+#endif
+
+void curve_fft_plan_init (curve_fft_plan_t *plan)
+{
+    memset (plan, 0, sizeof (*plan));
+}
+
+void curve_fft_plan_destroy (curve_fft_plan_t *plan)
+{
+    free (plan->tw_re);
+    free (plan->tw_im);
+    free (plan->split_re);
+    free (plan->split_im);
+    free (plan->bitrev);
+    free (plan->re);
+    free (plan->im);
+    curve_fft_plan_init (plan);
+}
+
+size_t curve_fft_floor_size (size_t n)
+{
+    if (n == 0) {
+        return 0;
+    }
+    size_t size = 1;
+    while (size <= n/2) {
+        size *= 2;
+    }
+    return size;
+}
+
+int curve_fft_plan_setup (curve_fft_plan_t *plan, size_t size)
+{
+    if (plan->size == size) {
+        return 0;
+    }
+    curve_fft_plan_destroy (plan);
+    size_t half = size/2;
+
+    plan->tw_re = malloc (half*sizeof (double));
+    plan->tw_im = malloc (half*sizeof (double));
+    plan->split_re = malloc ((half + 1)*sizeof (double));
+    plan->split_im = malloc ((half + 1)*sizeof (double));
+    plan->bitrev = malloc (half*sizeof (uint32_t));
+    plan->re = malloc (half*sizeof (double));
+    plan->im = malloc (half*sizeof (double));
+    if (plan->tw_re == NULL || plan->tw_im == NULL || plan->split_re == NULL ||
+            plan->split_im == NULL || plan->bitrev == NULL || plan->re == NULL || plan->im == NULL) {
+        curve_fft_plan_destroy (plan);
+        return -1;
+    }
+
+    for (size_t h = 1; h < half; h *= 2) {
+        for (size_t k = 0; k < h; k++) {
+            plan->tw_re[h - 1 + k] = cos (-M_PI*k/h);
+            plan->tw_im[h - 1 + k] = sin (-M_PI*k/h);
+        }
+    }
+    for (size_t k = 0; k <= half; k++) {
+        plan->split_re[k] = cos (-2*M_PI*k/size);
+        plan->split_im[k] = sin (-2*M_PI*k/size);
+    }
+
+    unsigned bits = 0;
+    while (((size_t) 1 << bits) < half) {
+        bits++;
+    }
+    for (size_t i = 0; i < half; i++) {
+        uint32_t r = 0;
+        for (unsigned b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        plan->bitrev[i] = r;
+    }
+
+    plan->size = size;
+    return 0;
+}
+
+/* One radix-2 stage of half width h over the n points of re, im */
+static void _fft_stage_scalar (double *re, double *im, size_t n, size_t h,
+        const double *wr, const double *wi)
+{
+    for (size_t j = 0; j < n; j += 2*h) {
+        for (size_t k = 0; k < h; k++) {
+            size_t a = j + k;
+            size_t b = a + h;
+            double tr = wr[k]*re[b] - wi[k]*im[b];
+            double ti = wr[k]*im[b] + wi[k]*re[b];
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+
+#ifdef CURVE_FFT_AVX2
+/* Same, 4 butterflies per step. h must be a multiple of 4 */
+__attribute__ ((target ("avx2")))
+static void _fft_stage_avx2 (double *re, double *im, size_t n, size_t h,
+        const double *wr, const double *wi)
+{
+    for (size_t j = 0; j < n; j += 2*h) {
+        for (size_t k = 0; k < h; k += 4) {
+            size_t a = j + k;
+            size_t b = a + h;
+            __m256d vwr = _mm256_loadu_pd (wr + k);
+            __m256d vwi = _mm256_loadu_pd (wi + k);
+            __m256d br = _mm256_loadu_pd (re + b);
+            __m256d bi = _mm256_loadu_pd (im + b);
+            __m256d ar = _mm256_loadu_pd (re + a);
+            __m256d ai = _mm256_loadu_pd (im + a);
+            __m256d tr = _mm256_sub_pd (_mm256_mul_pd (vwr, br), _mm256_mul_pd (vwi, bi));
+            __m256d ti = _mm256_add_pd (_mm256_mul_pd (vwr, bi), _mm256_mul_pd (vwi, br));
+            _mm256_storeu_pd (re + b, _mm256_sub_pd (ar, tr));
+            _mm256_storeu_pd (im + b, _mm256_sub_pd (ai, ti));
+            _mm256_storeu_pd (re + a, _mm256_add_pd (ar, tr));
+            _mm256_storeu_pd (im + a, _mm256_add_pd (ai, ti));
+        }
+    }
+}
+#endif
+
+/* In place complex FFT of the bit reversed n points of re, im */
+static void _fft (const curve_fft_plan_t *plan, double *re, double *im, size_t n)
+{
+    for (size_t h = 1; h < n; h *= 2) {
+        const double *wr = plan->tw_re + h - 1;
+        const double *wi = plan->tw_im + h - 1;
+#ifdef CURVE_FFT_AVX2
+        if (h >= 4 && cpu_has_avx2 ()) {
+            _fft_stage_avx2 (re, im, n, h, wr, wi);
+            continue;
+        }
+#endif
+        _fft_stage_scalar (re, im, n, h, wr, wi);
+    }
+}
+
+void curve_fft_power (curve_fft_plan_t *plan, const double *x, double *power)
+{
+    size_t half = plan->size/2;
+
+    /* Even points are the real part and odd ones the imaginary part of a
+     * half size complex sequence, loaded in bit reversed order */
+    for (size_t m = 0; m < half; m++) {
+        uint32_t r = plan->bitrev[m];
+        plan->re[r] = x[2*m];
+        plan->im[r] = x[2*m + 1];
+    }
+    _fft (plan, plan->re, plan->im, half);
+
+    /* Split the transforms of the even and odd points and combine them */
+    for (size_t k = 0; k <= half; k++) {
+        size_t k0 = (k == half) ? 0 : k;
+        size_t k1 = (k == 0) ? 0 : half - k;
+        double er = (plan->re[k0] + plan->re[k1])/2;
+        double ei = (plan->im[k0] - plan->im[k1])/2;
+        double or_ = (plan->im[k0] + plan->im[k1])/2;
+        double oi = (plan->re[k1] - plan->re[k0])/2;
+        double xr = er + plan->split_re[k]*or_ - plan->split_im[k]*oi;
+        double xi = ei + plan->split_re[k]*oi + plan->split_im[k]*or_;
+        power[k] = xr*xr + xi*xi;
+    }
+}
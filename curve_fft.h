@@ -0,0 +1,41 @@
+#ifndef _CURVE_FFT_H_
+#define _CURVE_FFT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Power spectrum of real sequences: a radix-2 complex FFT of half the
+ * size, with AVX2 butterflies where the CPU has it, followed by the split
+ * into the transform of the real sequence */
+
+/* Twiddles, bit reversal table and work buffers of one size, kept across
+ * transforms so that repeated ones do not set them up again */
+typedef struct {
+    /* Real FFT size, a power of 2. 0 until the first setup */
+    size_t size;
+    /* Twiddles of the size/2 point complex FFT, stage after stage: the
+     * stage of half width h uses h entries from h - 1 */
+    double *tw_re;
+    double *tw_im;
+    /* Twiddles of the split, size/2 + 1 entries */
+    double *split_re;
+    double *split_im;
+    uint32_t *bitrev;
+    double *re;
+    double *im;
+} curve_fft_plan_t;
+
+void curve_fft_plan_init (curve_fft_plan_t *plan);
+void curve_fft_plan_destroy (curve_fft_plan_t *plan);
+
+/* Set the plan up for size, a power of 2 of at least 4. Nothing is done
+ * if it already has that size. Returns -1 on allocation failure */
+int curve_fft_plan_setup (curve_fft_plan_t *plan, size_t size);
+
+/* Largest power of 2 not above n, 0 if n is 0 */
+size_t curve_fft_floor_size (size_t n);
+
+/* |X[k]|^2 of the plan size points of x into power, bins 0 to size/2 */
+void curve_fft_power (curve_fft_plan_t *plan, const double *x, double *power);
+
+#endif
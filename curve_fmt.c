@@ -0,0 +1,337 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "curve_fmt.h"
+
+#define CURVE_FMT_FIELD_WIDTH       8
+
+/* Rows formatted between two buffer space checks */
+#define CURVE_FMT_ROWS_PER_CHUNK    1024
+
+/* Two ASCII digits for every number in [0, 99] */
+static const char digits_lut[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* Equivalent to "%8d" */
+static inline char *_fmt_int (char *p, int32_t val)
+{
+    char tmp[12];
+    char *end = tmp + sizeof (tmp);
+    char *q = end;
+    uint32_t u = (val < 0) ? 0u - (uint32_t) val : (uint32_t) val;
+
+    while (u >= 100) {
+        uint32_t r = u % 100;
+        u /= 100;
+        q -= 2;
+        memcpy (q, &digits_lut[2*r], 2);
+    }
+
+    if (u >= 10) {
+        q -= 2;
+        memcpy (q, &digits_lut[2*u], 2);
+    } else {
+        *--q = '0' + u;
+    }
+
+    if (val < 0) {
+        *--q = '-';
+    }
+
+    size_t n = end - q;
+    if (n < CURVE_FMT_FIELD_WIDTH) {
+        memset (p, ' ', CURVE_FMT_FIELD_WIDTH - n);
+        p += CURVE_FMT_FIELD_WIDTH - n;
+    }
+    memcpy (p, q, n);
+    return p + n;
+}
+
+static inline char *_fmt_row (char *p, int32_t a, int32_t b, int32_t c, int32_t d)
+{
+    p = _fmt_int (p, a);
+    *p++ = '\t'; *p++ = ' ';
+    p = _fmt_int (p, b);
+    *p++ = '\t'; *p++ = ' ';
+    p = _fmt_int (p, c);
+    *p++ = '\t'; *p++ = ' ';
+    p = _fmt_int (p, d);
+    *p++ = '\n';
+    return p;
+}
+
+size_t curve_fmt_rows_i16x4 (char *dst, const int16_t *data, size_t rows)
+{
+    char *p = dst;
+    for (size_t i = 0; i < rows; i++, data += 4) {
+        p = _fmt_row (p, data[0], data[1], data[2], data[3]);
+    }
+    return p - dst;
+}
+
+size_t curve_fmt_rows_i32x4 (char *dst, const int32_t *data, size_t rows)
+{
+    char *p = dst;
+    for (size_t i = 0; i < rows; i++, data += 4) {
+        p = _fmt_row (p, data[0], data[1], data[2], data[3]);
+    }
+    return p - dst;
+}
+
+int curve_fmt_out_init (curve_fmt_out_t *out, int fd, size_t cap)
+{
+    if (cap < CURVE_FMT_ROWS_PER_CHUNK*CURVE_FMT_MAX_ROW_LEN) {
+        cap = CURVE_FMT_ROWS_PER_CHUNK*CURVE_FMT_MAX_ROW_LEN;
+    }
+
+    out->fd = fd;
+    out->sync_fp = NULL;
+    out->len = 0;
+    out->cap = cap;
+    out->err = 0;
+    out->hash = NULL;
+    out->pool = NULL;
+    out->buf = malloc (cap);
+    return (out->buf == NULL) ? -1 : 0;
+}
+
+void curve_fmt_out_destroy (curve_fmt_out_t *out)
+{
+    free (out->buf);
+    out->buf = NULL;
+    out->len = 0;
+    out->cap = 0;
+}
+
+static int _write_all (curve_fmt_out_t *out, const char *data, size_t size)
+{
+    if (size > 0 && out->sync_fp != NULL) {
+        fflush (out->sync_fp);
+    }
+    if (out->hash != NULL) {
+        curve_hash_update (out->hash, data, size);
+    }
+
+    while (size > 0 && out->err == 0) {
+        ssize_t n = write (out->fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            out->err = errno;
+            break;
+        }
+        data += n;
+        size -= n;
+    }
+    return (out->err == 0) ? 0 : -1;
+}
+
+int curve_fmt_flush (curve_fmt_out_t *out)
+{
+    int err = _write_all (out, out->buf, out->len);
+    out->len = 0;
+    return err;
+}
+
+int curve_fmt_write (curve_fmt_out_t *out, const void *data, size_t size)
+{
+    if (out->len + size <= out->cap) {
+        memcpy (out->buf + out->len, data, size);
+        out->len += size;
+        return 0;
+    }
+
+    /* Large payloads go straight to the descriptor */
+    if (curve_fmt_flush (out) < 0) {
+        return -1;
+    }
+    return _write_all (out, data, size);
+}
+
+void curve_fmt_pool_init (curve_fmt_pool_t *pool, unsigned num_threads)
+{
+    memset (pool, 0, sizeof (*pool));
+    pool->num_threads = num_threads;
+    pthread_mutex_init (&pool->lock, NULL);
+    pthread_cond_init (&pool->queued, NULL);
+    pthread_cond_init (&pool->done, NULL);
+}
+
+void curve_fmt_pool_destroy (curve_fmt_pool_t *pool)
+{
+    pthread_mutex_lock (&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast (&pool->queued);
+    pthread_mutex_unlock (&pool->lock);
+
+    for (unsigned i = 0; i < pool->num_started; i++) {
+        pthread_join (pool->threads[i], NULL);
+    }
+    for (unsigned i = 0; i < pool->num_jobs; i++) {
+        free (pool->jobs[i].buf);
+    }
+    free (pool->jobs);
+    free (pool->threads);
+    pthread_mutex_destroy (&pool->lock);
+    pthread_cond_destroy (&pool->queued);
+    pthread_cond_destroy (&pool->done);
+    memset (pool, 0, sizeof (*pool));
+}
+
+static void *_pool_worker (void *arg)
+{
+    curve_fmt_pool_t *pool = (curve_fmt_pool_t *) arg;
+
+    pthread_mutex_lock (&pool->lock);
+    while (1) {
+        while (pool->next_taken == pool->next_queued && !pool->stop) {
+            pthread_cond_wait (&pool->queued, &pool->lock);
+        }
+        if (pool->next_taken == pool->next_queued) {
+            break;
+        }
+        curve_fmt_job_t *job = &pool->jobs[pool->next_taken++ % pool->num_jobs];
+        pthread_mutex_unlock (&pool->lock);
+
+        job->len = (job->lane_size == sizeof (int16_t)) ?
+            curve_fmt_rows_i16x4 (job->buf, job->data, job->rows) :
+            curve_fmt_rows_i32x4 (job->buf, job->data, job->rows);
+
+        pthread_mutex_lock (&pool->lock);
+        job->done = 1;
+        pthread_cond_signal (&pool->done);
+    }
+    pthread_mutex_unlock (&pool->lock);
+    return NULL;
+}
+
+/* Start the threads and the jobs, once. Returns -1 if no thread could be
+ * started */
+static int _pool_start (curve_fmt_pool_t *pool)
+{
+    if (pool->num_started > 0) {
+        return 0;
+    }
+    if (pool->threads != NULL) {
+        /* A previous start failed */
+        return -1;
+    }
+
+    pool->num_jobs = pool->num_threads*CURVE_FMT_PAR_JOBS_PER_THREAD;
+    pool->threads = calloc (pool->num_threads, sizeof (pthread_t));
+    pool->jobs = calloc (pool->num_jobs, sizeof (curve_fmt_job_t));
+    if (pool->threads == NULL || pool->jobs == NULL) {
+        return -1;
+    }
+    for (unsigned i = 0; i < pool->num_jobs; i++) {
+        pool->jobs[i].buf = malloc (CURVE_FMT_PAR_ROWS_PER_JOB*CURVE_FMT_MAX_ROW_LEN);
+        if (pool->jobs[i].buf == NULL) {
+            return -1;
+        }
+    }
+
+    for ( ; pool->num_started < pool->num_threads; pool->num_started++) {
+        if (pthread_create (&pool->threads[pool->num_started], NULL, _pool_worker, pool) != 0) {
+            break;
+        }
+    }
+    return (pool->num_started > 0) ? 0 : -1;
+}
+
+/* Queue the rows in jobs, keeping at most num_jobs in flight, and write
+ * the jobs back in submission order as they complete */
+static int _text_par (curve_fmt_out_t *out, const void *data, size_t rows, size_t lane_size)
+{
+    curve_fmt_pool_t *pool = out->pool;
+    size_t num_jobs = (rows + CURVE_FMT_PAR_ROWS_PER_JOB - 1)/CURVE_FMT_PAR_ROWS_PER_JOB;
+    size_t queued = 0;
+    size_t written = 0;
+    int err = (out->err == 0) ? 0 : -1;
+
+    pthread_mutex_lock (&pool->lock);
+    uint64_t first = pool->next_queued;
+    while (written < queued || (err == 0 && queued < num_jobs)) {
+        /* After an error, only wait for the jobs in flight */
+        for ( ; err == 0 && queued < num_jobs && queued - written < pool->num_jobs; queued++) {
+            curve_fmt_job_t *job = &pool->jobs[(first + queued) % pool->num_jobs];
+            size_t row = queued*CURVE_FMT_PAR_ROWS_PER_JOB;
+            job->data = (const char *) data + row*4*lane_size;
+            job->rows = (rows - row < CURVE_FMT_PAR_ROWS_PER_JOB) ? rows - row : CURVE_FMT_PAR_ROWS_PER_JOB;
+            job->lane_size = lane_size;
+            job->done = 0;
+            pool->next_queued++;
+            pthread_cond_signal (&pool->queued);
+        }
+
+        curve_fmt_job_t *job = &pool->jobs[(first + written) % pool->num_jobs];
+        while (!job->done) {
+            pthread_cond_wait (&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock (&pool->lock);
+
+        if (err == 0 && curve_fmt_write (out, job->buf, job->len) < 0) {
+            err = -1;
+        }
+
+        pthread_mutex_lock (&pool->lock);
+        written++;
+    }
+    pthread_mutex_unlock (&pool->lock);
+    return err;
+}
+
+/* Whether rows go to the formatting pool */
+static int _use_pool (curve_fmt_out_t *out, size_t rows)
+{
+    return out->pool != NULL && out->pool->num_threads > 1 &&
+        rows >= 2*CURVE_FMT_PAR_ROWS_PER_JOB && _pool_start (out->pool) == 0;
+}
+
+int curve_fmt_text_i16x4 (curve_fmt_out_t *out, const int16_t *data, size_t rows)
+{
+    if (_use_pool (out, rows)) {
+        return _text_par (out, data, rows, sizeof (int16_t));
+    }
+
+    while (rows > 0) {
+        size_t chunk = (rows < CURVE_FMT_ROWS_PER_CHUNK) ? rows : CURVE_FMT_ROWS_PER_CHUNK;
+        if (out->cap - out->len < chunk*CURVE_FMT_MAX_ROW_LEN &&
+                curve_fmt_flush (out) < 0) {
+            return -1;
+        }
+        out->len += curve_fmt_rows_i16x4 (out->buf + out->len, data, chunk);
+        data += 4*chunk;
+        rows -= chunk;
+    }
+    return (out->err == 0) ? 0 : -1;
+}
+
+int curve_fmt_text_i32x4 (curve_fmt_out_t *out, const int32_t *data, size_t rows)
+{
+    if (_use_pool (out, rows)) {
+        return _text_par (out, data, rows, sizeof (int32_t));
+    }
+
+    while (rows > 0) {
+        size_t chunk = (rows < CURVE_FMT_ROWS_PER_CHUNK) ? rows : CURVE_FMT_ROWS_PER_CHUNK;
+        if (out->cap - out->len < chunk*CURVE_FMT_MAX_ROW_LEN &&
+                curve_fmt_flush (out) < 0) {
+            return -1;
+        }
+        out->len += curve_fmt_rows_i32x4 (out->buf + out->len, data, chunk);
+        data += 4*chunk;
+        rows -= chunk;
+    }
+    return (out->err == 0) ? 0 : -1;
+}
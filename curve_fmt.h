@@ -0,0 +1,92 @@
+#ifndef _CURVE_FMT_H_
+#define _CURVE_FMT_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "curve_hash.h"
+
+/* Output buffer size used when none is given */
+#define CURVE_FMT_DFLT_BUF_SIZE     (1 << 20)
+
+/* Longest text row: 4 fields of up to 11 characters ("-2147483648"),
+ * 3 "\t " separators and the newline */
+#define CURVE_FMT_MAX_ROW_LEN       (4*11 + 3*2 + 1)
+
+/* Rows formatted by one job of a formatting pool */
+#define CURVE_FMT_PAR_ROWS_PER_JOB  4096
+/* Jobs in flight per pool thread */
+#define CURVE_FMT_PAR_JOBS_PER_THREAD 2
+
+typedef struct {
+    const void *data;
+    size_t rows;
+    /* 2 for int16x4 rows, 4 for int32x4 rows */
+    size_t lane_size;
+    char *buf;
+    size_t len;
+    int done;
+} curve_fmt_job_t;
+
+/* Threads formatting the text of large outputs in parallel, in row
+ * aligned jobs that are written back in order. The threads are started
+ * by the first output large enough to be split */
+typedef struct {
+    unsigned num_threads;
+    pthread_t *threads;
+    unsigned num_started;
+    /* Ring of jobs. Jobs are numbered in submission order and
+     * [next_taken, next_queued) wait for a thread */
+    curve_fmt_job_t *jobs;
+    unsigned num_jobs;
+    uint64_t next_queued;
+    uint64_t next_taken;
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    pthread_cond_t done;
+} curve_fmt_pool_t;
+
+/* num_threads <= 1 formats in the calling thread */
+void curve_fmt_pool_init (curve_fmt_pool_t *pool, unsigned num_threads);
+void curve_fmt_pool_destroy (curve_fmt_pool_t *pool);
+
+/* Buffered output to a file descriptor. Data is accumulated in a large
+ * buffer and handed to write() when the buffer fills up or on flush */
+typedef struct {
+    int fd;
+    /* Optional stdio stream writing to the same descriptor. It is flushed
+     * before every write() so that both outputs keep their order */
+    FILE *sync_fp;
+    char *buf;
+    size_t len;
+    size_t cap;
+    /* errno of the first failed write(), 0 otherwise */
+    int err;
+    /* Optional digest of every byte handed to write() */
+    curve_hash_t *hash;
+    /* Optional pool formatting the text in parallel. The output is the
+     * same byte for byte */
+    curve_fmt_pool_t *pool;
+} curve_fmt_out_t;
+
+int curve_fmt_out_init (curve_fmt_out_t *out, int fd, size_t cap);
+void curve_fmt_out_destroy (curve_fmt_out_t *out);
+int curve_fmt_flush (curve_fmt_out_t *out);
+
+/* Append raw bytes */
+int curve_fmt_write (curve_fmt_out_t *out, const void *data, size_t size);
+
+/* Format rows of 4 interleaved lanes exactly as
+ * printf ("%8d\t %8d\t %8d\t %8d\n", ...) would */
+int curve_fmt_text_i16x4 (curve_fmt_out_t *out, const int16_t *data, size_t rows);
+int curve_fmt_text_i32x4 (curve_fmt_out_t *out, const int32_t *data, size_t rows);
+
+/* Same formatting into a caller buffer of at least rows*CURVE_FMT_MAX_ROW_LEN
+ * bytes. Return the number of bytes written */
+size_t curve_fmt_rows_i16x4 (char *dst, const int16_t *data, size_t rows);
+size_t curve_fmt_rows_i32x4 (char *dst, const int32_t *data, size_t rows);
+
+#endif
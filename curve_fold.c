@@ -0,0 +1,119 @@
+#include <math.h>
+#include "curve_fold.h"
+#include "cpu_feat.h"
+
+#ifdef CPU_FEAT_AVX2
+#define CURVE_FOLD_AVX2
+#include <immintrin.h>
+#endif
+
+size_t curve_fold_sq_i16x4_scalar (int64_t *sums, size_t period, size_t phase,
+        const int16_t *data, size_t rows)
+{
+    for (size_t i = 0; i < rows; i++) {
+        for (int l = 0; l < 4; l++) {
+            int32_t x = data[4*i + l];
+            sums[4*phase + l] += x*x;
+        }
+        phase = (phase + 1 == period) ? 0 : phase + 1;
+    }
+    return phase;
+}
+
+#ifdef CURVE_FOLD_AVX2
+/* One row per step: its 4 lanes are widened, squared (|x| <= 2^15, so
+ * x^2 fits in int32) and added to the 4 int64 sums of its phase. The
+ * rows are taken in runs of consecutive phases, up to the end of the
+ * period */
+__attribute__ ((target ("avx2")))
+static size_t _fold_sq_i16x4_avx2 (int64_t *sums, size_t period, size_t phase,
+        const int16_t *data, size_t rows)
+{
+    size_t i = 0;
+    while (i < rows) {
+        size_t run = period - phase;
+        run = (rows - i < run) ? rows - i : run;
+        int64_t *acc = sums + 4*phase;
+        const int16_t *row = data + 4*i;
+        for (size_t r = 0; r < run; r++) {
+            __m128i x = _mm_cvtepi16_epi32 (_mm_loadl_epi64 ((const __m128i *) (row + 4*r)));
+            __m256i sq = _mm256_cvtepi32_epi64 (_mm_mullo_epi32 (x, x));
+            __m256i s = _mm256_loadu_si256 ((const __m256i *) (acc + 4*r));
+            _mm256_storeu_si256 ((__m256i *) (acc + 4*r), _mm256_add_epi64 (s, sq));
+        }
+        i += run;
+        phase = (phase + run == period) ? 0 : phase + run;
+    }
+    return phase;
+}
+#endif
+
+size_t curve_fold_sq_i16x4 (int64_t *sums, size_t period, size_t phase, const int16_t *data,
+        size_t rows)
+{
+#ifdef CURVE_FOLD_AVX2
+    if (cpu_has_avx2 ()) {
+        return _fold_sq_i16x4_avx2 (sums, period, phase, data, rows);
+    }
+#endif
+    return curve_fold_sq_i16x4_scalar (sums, period, phase, data, rows);
+}
+
+/* Number of the rows rows folded from phase 0 that fall on phase */
+static uint64_t _phase_count (size_t phase, size_t period, uint64_t rows)
+{
+    return rows/period + ((phase < rows % period) ? 1 : 0);
+}
+
+static double _mean_sq (const int64_t *sums, size_t period, uint64_t rows, size_t phase, int lane)
+{
+    return (double) sums[4*phase + lane]/_phase_count (phase, period, rows);
+}
+
+void curve_fold_sw (const int64_t *sums, size_t period, uint64_t rows, curve_fold_sw_t result[4])
+{
+    size_t num_bins = (period < CURVE_FOLD_NUM_BINS) ? period : CURVE_FOLD_NUM_BINS;
+    size_t half = period/2;
+
+    for (int l = 0; l < 4; l++) {
+        /* Binned envelope */
+        double env_min = INFINITY, env_max = 0, env_sum = 0;
+        for (size_t b = 0; b < num_bins; b++) {
+            size_t first = b*period/num_bins;
+            size_t end = (b + 1)*period/num_bins;
+            double ms = 0;
+            for (size_t p = first; p < end; p++) {
+                ms += _mean_sq (sums, period, rows, p, l);
+            }
+            double env = sqrt (ms/(end - first));
+            env_min = (env < env_min) ? env : env_min;
+            env_max = (env > env_max) ? env : env_max;
+            env_sum += env;
+        }
+        double env_mean = env_sum/num_bins;
+        result[l].ripple = (env_mean > 0) ? (env_max - env_min)/env_mean : 0;
+
+        /* Half period window sliding around the period */
+        double total = 0;
+        for (size_t p = 0; p < period; p++) {
+            total += _mean_sq (sums, period, rows, p, l);
+        }
+        double window = 0;
+        for (size_t p = 0; p < half; p++) {
+            window += _mean_sq (sums, period, rows, p, l);
+        }
+        double best_window = window;
+        double best_diff = -1;
+        for (size_t start = 0; start < period; start++) {
+            double diff = fabs (window/half - (total - window)/(period - half));
+            if (diff > best_diff) {
+                best_diff = diff;
+                best_window = window;
+            }
+            window += _mean_sq (sums, period, rows, (start + half) % period, l) -
+                _mean_sq (sums, period, rows, start, l);
+        }
+        result[l].state_rms[0] = sqrt (best_window/half);
+        result[l].state_rms[1] = sqrt ((total - best_window)/(period - half));
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef _CURVE_FOLD_H_
+#define _CURVE_FOLD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Phase folding of ADC curves over the RFFE switching period: the squares
+ * of the samples of 4 interleaved int16 lanes are summed per phase of the
+ * period, in exact int64 sums, with AVX2 where the CPU has it. The folded
+ * mean squares give the power of each lane through the period, from which
+ * the switching figures are taken */
+
+/* Phase bins of the envelope the ripple is measured on. Each bin averages
+ * period/CURVE_FOLD_NUM_BINS phases, which smooths out the carrier */
+#define CURVE_FOLD_NUM_BINS         32
+
+typedef struct {
+    /* RMS of each switching state: the two halves of the period, aligned
+     * where their mean squares differ the most */
+    double state_rms[2];
+    /* Peak to peak of the binned RMS envelope over the period, relative
+     * to its mean */
+    double ripple;
+} curve_fold_sw_t;
+
+/* Add the squares of rows rows of data to sums[4*phase + lane], the phase
+ * of row i being (phase + i) mod period. sums holds 4*period entries.
+ * Returns the phase of the row after the last one */
+size_t curve_fold_sq_i16x4 (int64_t *sums, size_t period, size_t phase, const int16_t *data,
+        size_t rows);
+
+/* Same, always with plain loops */
+size_t curve_fold_sq_i16x4_scalar (int64_t *sums, size_t period, size_t phase,
+        const int16_t *data, size_t rows);
+
+/* Switching figures of each lane of sums, folded from phase 0 over rows
+ * rows. period must be at least 2 and rows at least period */
+void curve_fold_sw (const int64_t *sums, size_t period, uint64_t rows, curve_fold_sw_t result[4]);
+
+#endif
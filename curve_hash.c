@@ -0,0 +1,290 @@
+#include <string.h>
+#include "curve_hash.h"
+
+#define ROTL32(x, n)        (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR32(x, n)        (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const char *alg_names [END_CURVE_HASH] = {
+    [CURVE_HASH_NONE] = "none",
+    [CURVE_HASH_MD5] = "md5",
+    [CURVE_HASH_SHA1] = "sha1",
+    [CURVE_HASH_SHA256] = "sha256"
+};
+
+/* Digest sizes [bytes] */
+static const size_t alg_sizes [END_CURVE_HASH] = {
+    [CURVE_HASH_NONE] = 0,
+    [CURVE_HASH_MD5] = 16,
+    [CURVE_HASH_SHA1] = 20,
+    [CURVE_HASH_SHA256] = 32
+};
+
+static inline uint32_t _load_le32 (const uint8_t *p)
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline uint32_t _load_be32 (const uint8_t *p)
+{
+    return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | (uint32_t) p[3];
+}
+
+/********************************** MD5 (RFC 1321) ***********************************/
+
+static const uint32_t md5_k [64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint8_t md5_r [64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void _md5_block (uint32_t *state, const uint8_t *block)
+{
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++) {
+        w[i] = _load_le32 (block + 4*i);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5*i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3*i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7*i) % 16;
+        }
+        uint32_t tmp = d;
+        d = c;
+        c = b;
+        b = b + ROTL32 (a + f + md5_k[i] + w[g], md5_r[i]);
+        a = tmp;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+}
+
+/********************************** SHA-1 (FIPS 180-4) ***********************************/
+
+static void _sha1_block (uint32_t *state, const uint8_t *block)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = _load_be32 (block + 4*i);
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = ROTL32 (w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t tmp = ROTL32 (a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROTL32 (b, 30);
+        b = a;
+        a = tmp;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+}
+
+/********************************** SHA-256 (FIPS 180-4) ***********************************/
+
+static const uint32_t sha256_k [64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void _sha256_block (uint32_t *state, const uint8_t *block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = _load_be32 (block + 4*i);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32 (w[i-15], 7) ^ ROTR32 (w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = ROTR32 (w[i-2], 17) ^ ROTR32 (w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROTR32 (e, 6) ^ ROTR32 (e, 11) ^ ROTR32 (e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = ROTR32 (a, 2) ^ ROTR32 (a, 13) ^ ROTR32 (a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/********************************** Common ***********************************/
+
+curve_hash_alg_e curve_hash_alg_parse (const char *name)
+{
+    for (int alg = CURVE_HASH_NONE+1; alg < END_CURVE_HASH; alg++) {
+        if (strcmp (name, alg_names[alg]) == 0) {
+            return alg;
+        }
+    }
+    return CURVE_HASH_NONE;
+}
+
+const char *curve_hash_alg_name (curve_hash_alg_e alg)
+{
+    return (alg < END_CURVE_HASH) ? alg_names[alg] : alg_names[CURVE_HASH_NONE];
+}
+
+void curve_hash_init (curve_hash_t *hash, curve_hash_alg_e alg)
+{
+    static const uint32_t md5_iv [4] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+    };
+    static const uint32_t sha1_iv [5] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+    };
+    static const uint32_t sha256_iv [8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memset (hash, 0, sizeof (*hash));
+    hash->alg = alg;
+    switch (alg) {
+        case CURVE_HASH_MD5:
+            memcpy (hash->state, md5_iv, sizeof (md5_iv));
+            break;
+        case CURVE_HASH_SHA1:
+            memcpy (hash->state, sha1_iv, sizeof (sha1_iv));
+            break;
+        case CURVE_HASH_SHA256:
+            memcpy (hash->state, sha256_iv, sizeof (sha256_iv));
+            break;
+        default:
+            break;
+    }
+}
+
+static void _hash_block (curve_hash_t *hash, const uint8_t *block)
+{
+    switch (hash->alg) {
+        case CURVE_HASH_MD5:
+            _md5_block (hash->state, block);
+            break;
+        case CURVE_HASH_SHA1:
+            _sha1_block (hash->state, block);
+            break;
+        case CURVE_HASH_SHA256:
+            _sha256_block (hash->state, block);
+            break;
+        default:
+            break;
+    }
+}
+
+void curve_hash_update (curve_hash_t *hash, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    hash->len += size;
+
+    if (hash->block_len > 0) {
+        size_t n = sizeof (hash->block) - hash->block_len;
+        if (n > size) {
+            n = size;
+        }
+        memcpy (hash->block + hash->block_len, p, n);
+        hash->block_len += n;
+        p += n;
+        size -= n;
+        if (hash->block_len < sizeof (hash->block)) {
+            return;
+        }
+        _hash_block (hash, hash->block);
+        hash->block_len = 0;
+    }
+
+    /* Whole blocks are hashed in place */
+    for ( ; size >= sizeof (hash->block); p += sizeof (hash->block), size -= sizeof (hash->block)) {
+        _hash_block (hash, p);
+    }
+
+    memcpy (hash->block, p, size);
+    hash->block_len = size;
+}
+
+void curve_hash_final_hex (curve_hash_t *hash, char *hex)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    uint64_t bits = hash->len*8;
+    uint8_t pad[72] = {0x80};
+    uint8_t len[8];
+
+    /* Message length, little endian for MD5 and big endian for SHA */
+    for (int i = 0; i < 8; i++) {
+        len[i] = (hash->alg == CURVE_HASH_MD5) ? bits >> (8*i) : bits >> (56 - 8*i);
+    }
+
+    size_t pad_len = (hash->block_len < 56) ? 56 - hash->block_len : 120 - hash->block_len;
+    curve_hash_update (hash, pad, pad_len);
+    curve_hash_update (hash, len, sizeof (len));
+
+    size_t size = alg_sizes[hash->alg < END_CURVE_HASH ? hash->alg : CURVE_HASH_NONE];
+    for (size_t i = 0; i < size; i++) {
+        uint32_t word = hash->state[i/4];
+        uint8_t byte = (hash->alg == CURVE_HASH_MD5) ? word >> (8*(i % 4)) : word >> (24 - 8*(i % 4));
+        hex[2*i] = hex_digits[byte >> 4];
+        hex[2*i+1] = hex_digits[byte & 0xf];
+    }
+    hex[2*size] = '\0';
+}
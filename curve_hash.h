@@ -0,0 +1,43 @@
+#ifndef _CURVE_HASH_H_
+#define _CURVE_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Incremental message digests of the curve output, computed as the bytes
+ * are written so no file has to be read back */
+
+typedef enum {
+    CURVE_HASH_NONE = 0,
+    CURVE_HASH_MD5,
+    CURVE_HASH_SHA1,
+    CURVE_HASH_SHA256,
+    END_CURVE_HASH
+} curve_hash_alg_e;
+
+#define CURVE_HASH_MAX_DIGEST_SIZE  32
+/* Hex digest and its terminating NUL */
+#define CURVE_HASH_MAX_HEX_SIZE     (2*CURVE_HASH_MAX_DIGEST_SIZE + 1)
+
+typedef struct {
+    curve_hash_alg_e alg;
+    uint32_t state[8];
+    /* Bytes hashed so far */
+    uint64_t len;
+    uint8_t block[64];
+    size_t block_len;
+} curve_hash_t;
+
+/* Algorithm named "md5", "sha1" or "sha256", CURVE_HASH_NONE if unknown */
+curve_hash_alg_e curve_hash_alg_parse (const char *name);
+const char *curve_hash_alg_name (curve_hash_alg_e alg);
+
+void curve_hash_init (curve_hash_t *hash, curve_hash_alg_e alg);
+void curve_hash_update (curve_hash_t *hash, const void *data, size_t size);
+
+/* Finish the digest and write it as a lowercase hex string to hex, of at
+ * least CURVE_HASH_MAX_HEX_SIZE bytes. The hash must be initialized again
+ * before being reused */
+void curve_hash_final_hex (curve_hash_t *hash, char *hex);
+
+#endif
@@ -0,0 +1,103 @@
+#include "curve_pos.h"
+#include "cpu_feat.h"
+
+#ifdef CPU_FEAT_AVX2
+#define CURVE_POS_AVX2
+#include <immintrin.h>
+#endif
+
+/* Both paths take the same steps in the same order, so they round alike:
+ * the sums and differences of the int32 amplitudes are exact and only 1/S
+ * and the products round */
+static inline void _pos_row (double *dst, const int32_t *row, const curve_pos_gains_t *gains)
+{
+    double a = row[0], b = row[1], c = row[2], d = row[3];
+    double ac = a - c;
+    double bd = b - d;
+    double s = (a + c) + (b + d);
+    double inv = 1.0/s;
+
+    dst[0] = (ac - bd)*inv*gains->kx;
+    dst[1] = (ac + bd)*inv*gains->ky;
+    dst[2] = ((a + c) - (b + d))*inv;
+    dst[3] = s*gains->ksum;
+}
+
+void curve_pos_i32x4_scalar (double *dst, const int32_t *data, size_t rows,
+        const curve_pos_gains_t *gains)
+{
+    for (size_t i = 0; i < rows; i++) {
+        _pos_row (dst + 4*i, data + 4*i, gains);
+    }
+}
+
+#ifdef CURVE_POS_AVX2
+/* In place transpose of 4 rows of 4 doubles */
+__attribute__ ((target ("avx2")))
+static inline void _transpose_pd (__m256d *r0, __m256d *r1, __m256d *r2, __m256d *r3)
+{
+    __m256d t0 = _mm256_unpacklo_pd (*r0, *r1);
+    __m256d t1 = _mm256_unpackhi_pd (*r0, *r1);
+    __m256d t2 = _mm256_unpacklo_pd (*r2, *r3);
+    __m256d t3 = _mm256_unpackhi_pd (*r2, *r3);
+    *r0 = _mm256_permute2f128_pd (t0, t2, 0x20);
+    *r1 = _mm256_permute2f128_pd (t1, t3, 0x20);
+    *r2 = _mm256_permute2f128_pd (t0, t2, 0x31);
+    *r3 = _mm256_permute2f128_pd (t1, t3, 0x31);
+}
+
+/* 4 rows per step: the rows are widened to doubles and transposed, so
+ * that each register holds one lane of the 4 rows, and the results are
+ * transposed back into rows */
+__attribute__ ((target ("avx2")))
+static void _pos_i32x4_avx2 (double *dst, const int32_t *data, size_t rows,
+        const curve_pos_gains_t *gains)
+{
+    const __m256d kx = _mm256_set1_pd (gains->kx);
+    const __m256d ky = _mm256_set1_pd (gains->ky);
+    const __m256d ksum = _mm256_set1_pd (gains->ksum);
+    const __m256d one = _mm256_set1_pd (1.0);
+    size_t i = 0;
+
+    for ( ; i + 4 <= rows; i += 4) {
+        const __m128i *src = (const __m128i *) (data + 4*i);
+        __m256d a = _mm256_cvtepi32_pd (_mm_loadu_si128 (src));
+        __m256d b = _mm256_cvtepi32_pd (_mm_loadu_si128 (src + 1));
+        __m256d c = _mm256_cvtepi32_pd (_mm_loadu_si128 (src + 2));
+        __m256d d = _mm256_cvtepi32_pd (_mm_loadu_si128 (src + 3));
+        _transpose_pd (&a, &b, &c, &d);
+
+        __m256d ac = _mm256_sub_pd (a, c);
+        __m256d bd = _mm256_sub_pd (b, d);
+        __m256d a_c = _mm256_add_pd (a, c);
+        __m256d b_d = _mm256_add_pd (b, d);
+        __m256d s = _mm256_add_pd (a_c, b_d);
+        __m256d inv = _mm256_div_pd (one, s);
+
+        __m256d x = _mm256_mul_pd (_mm256_mul_pd (_mm256_sub_pd (ac, bd), inv), kx);
+        __m256d y = _mm256_mul_pd (_mm256_mul_pd (_mm256_add_pd (ac, bd), inv), ky);
+        __m256d q = _mm256_mul_pd (_mm256_sub_pd (a_c, b_d), inv);
+        __m256d sum = _mm256_mul_pd (s, ksum);
+        _transpose_pd (&x, &y, &q, &sum);
+
+        _mm256_storeu_pd (dst + 4*i, x);
+        _mm256_storeu_pd (dst + 4*i + 4, y);
+        _mm256_storeu_pd (dst + 4*i + 8, q);
+        _mm256_storeu_pd (dst + 4*i + 12, sum);
+    }
+
+    curve_pos_i32x4_scalar (dst + 4*i, data + 4*i, rows - i, gains);
+}
+#endif
+
+void curve_pos_i32x4 (double *dst, const int32_t *data, size_t rows,
+        const curve_pos_gains_t *gains)
+{
+#ifdef CURVE_POS_AVX2
+    if (cpu_has_avx2 ()) {
+        _pos_i32x4_avx2 (dst, data, rows, gains);
+        return;
+    }
+#endif
+    curve_pos_i32x4_scalar (dst, data, rows, gains);
+}
@@ -0,0 +1,38 @@
+#ifndef _CURVE_POS_H_
+#define _CURVE_POS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Beam position from rows of 4 interleaved button amplitudes (A, B, C, D),
+ * with the delta over sigma formulas of the DSP core:
+ *
+ *   x   = Kx (A - B - C + D)/S
+ *   y   = Ky (A + B - C - D)/S
+ *   q   =    (A - B + C - D)/S
+ *   sum = Ksum S, with S = A + B + C + D
+ *
+ * Each output row holds x, y, q and sum as doubles. Rows with S = 0 give
+ * NaN or infinite positions. AVX2 is used where the CPU has it */
+
+/* Ksum, as written by --setksum, is a fixed point gain with 24 fractional
+ * bits */
+#define CURVE_POS_KSUM_ONE          (1 << 24)
+
+typedef struct {
+    /* Position gains, in the unit of the output positions */
+    double kx;
+    double ky;
+    /* Sum gain, as a factor */
+    double ksum;
+} curve_pos_gains_t;
+
+/* dst holds 4*rows doubles. dst and data must not overlap */
+void curve_pos_i32x4 (double *dst, const int32_t *data, size_t rows,
+        const curve_pos_gains_t *gains);
+
+/* Same, always with plain loops */
+void curve_pos_i32x4_scalar (double *dst, const int32_t *data, size_t rows,
+        const curve_pos_gains_t *gains);
+
+#endif
@@ -0,0 +1,197 @@
+#include <math.h>
+#include <string.h>
+#include "curve_reduce.h"
+#include "cpu_feat.h"
+
+#ifdef CPU_FEAT_AVX2
+#define CURVE_REDUCE_AVX2
+#include <immintrin.h>
+#endif
+
+/* Rows per block: 64 KiB of int32x4 samples. The exact int64 sum of a
+ * block can not overflow */
+#define CURVE_REDUCE_BLOCK_ROWS     4096
+
+/* Exact moments of one block */
+typedef struct {
+    int64_t sum[CURVE_REDUCE_NUM_LANES];
+    int32_t min[CURVE_REDUCE_NUM_LANES];
+    int32_t max[CURVE_REDUCE_NUM_LANES];
+    double m2[CURVE_REDUCE_NUM_LANES];
+} curve_block_t;
+
+void curve_reduce_init (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES])
+{
+    for (int l = 0; l < CURVE_REDUCE_NUM_LANES; l++) {
+        memset (&stats[l], 0, sizeof (stats[l]));
+        stats[l].min = INT32_MAX;
+        stats[l].max = INT32_MIN;
+    }
+}
+
+static void _merge_block (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES],
+        const curve_block_t *block, size_t rows)
+{
+    for (int l = 0; l < CURVE_REDUCE_NUM_LANES; l++) {
+        curve_lane_stats_t *s = &stats[l];
+        double n_a = (double) s->count;
+        double n_b = (double) rows;
+        double mean_b = (double) block->sum[l]/n_b;
+        double delta = mean_b - s->mean;
+        double n = n_a + n_b;
+
+        s->mean += delta*n_b/n;
+        s->m2 += block->m2[l] + delta*delta*n_a*n_b/n;
+        s->count += rows;
+        s->min = (block->min[l] < s->min) ? block->min[l] : s->min;
+        s->max = (block->max[l] > s->max) ? block->max[l] : s->max;
+    }
+}
+
+/* Block moments with plain loops, for int16_t or int32_t data */
+#define CURVE_REDUCE_BLOCK_SCALAR(block, data, rows)                            \
+    do {                                                                        \
+        for (int l = 0; l < CURVE_REDUCE_NUM_LANES; l++) {                      \
+            (block)->sum[l] = 0;                                                \
+            (block)->min[l] = INT32_MAX;                                        \
+            (block)->max[l] = INT32_MIN;                                        \
+            (block)->m2[l] = 0;                                                 \
+        }                                                                       \
+        for (size_t i = 0; i < (rows); i++) {                                   \
+            for (int l = 0; l < CURVE_REDUCE_NUM_LANES; l++) {                  \
+                int32_t x = (data)[4*i + l];                                    \
+                (block)->sum[l] += x;                                           \
+                (block)->min[l] = (x < (block)->min[l]) ? x : (block)->min[l];  \
+                (block)->max[l] = (x > (block)->max[l]) ? x : (block)->max[l];  \
+            }                                                                   \
+        }                                                                       \
+        double mean[CURVE_REDUCE_NUM_LANES];                                    \
+        for (int l = 0; l < CURVE_REDUCE_NUM_LANES; l++) {                      \
+            mean[l] = (double) (block)->sum[l]/(rows);                          \
+        }                                                                       \
+        for (size_t i = 0; i < (rows); i++) {                                   \
+            for (int l = 0; l < CURVE_REDUCE_NUM_LANES; l++) {                  \
+                double d = (data)[4*i + l] - mean[l];                           \
+                (block)->m2[l] += d*d;                                          \
+            }                                                                   \
+        }                                                                       \
+    } while (0)
+
+static void _block_i16x4_scalar (curve_block_t *block, const int16_t *data, size_t rows)
+{
+    CURVE_REDUCE_BLOCK_SCALAR (block, data, rows);
+}
+
+static void _block_i32x4_scalar (curve_block_t *block, const int32_t *data, size_t rows)
+{
+    CURVE_REDUCE_BLOCK_SCALAR (block, data, rows);
+}
+
+#ifdef CURVE_REDUCE_AVX2
+/* One row, its 4 lanes widened to int32, per step: min and max in 128 bit
+ * registers, the sum in 4 int64 and the squared deviations in 4 doubles */
+__attribute__ ((target ("avx2")))
+static inline __m128i _load_i16x4 (const int16_t *row)
+{
+    return _mm_cvtepi16_epi32 (_mm_loadl_epi64 ((const __m128i *) row));
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m128i _load_i32x4 (const int32_t *row)
+{
+    return _mm_loadu_si128 ((const __m128i *) row);
+}
+
+/* AVX2 has no int64 to double conversion: the block sums are below 2^53 in
+ * magnitude and convert exactly through the scalar path */
+__attribute__ ((target ("avx2")))
+static inline __m256d _sum_pd (__m256i v)
+{
+    int64_t s[4];
+    _mm256_storeu_si256 ((__m256i *) s, v);
+    return _mm256_setr_pd ((double) s[0], (double) s[1], (double) s[2], (double) s[3]);
+}
+
+#define CURVE_REDUCE_BLOCK_AVX2(block, data, rows, load)                        \
+    do {                                                                        \
+        __m128i vmin = _mm_set1_epi32 (INT32_MAX);                              \
+        __m128i vmax = _mm_set1_epi32 (INT32_MIN);                              \
+        __m256i vsum = _mm256_setzero_si256 ();                                 \
+        for (size_t i = 0; i < (rows); i++) {                                   \
+            __m128i v = load ((data) + 4*i);                                    \
+            vmin = _mm_min_epi32 (vmin, v);                                     \
+            vmax = _mm_max_epi32 (vmax, v);                                     \
+            vsum = _mm256_add_epi64 (vsum, _mm256_cvtepi32_epi64 (v));          \
+        }                                                                       \
+        _mm_storeu_si128 ((__m128i *) (block)->min, vmin);                      \
+        _mm_storeu_si128 ((__m128i *) (block)->max, vmax);                      \
+        _mm256_storeu_si256 ((__m256i *) (block)->sum, vsum);                   \
+                                                                                \
+        __m256d vmean = _mm256_div_pd (_sum_pd (vsum),                          \
+                _mm256_set1_pd ((double) (rows)));                              \
+        __m256d vm2 = _mm256_setzero_pd ();                                     \
+        for (size_t i = 0; i < (rows); i++) {                                   \
+            __m256d d = _mm256_sub_pd (_mm256_cvtepi32_pd (load ((data) + 4*i)), vmean); \
+            vm2 = _mm256_add_pd (vm2, _mm256_mul_pd (d, d));                    \
+        }                                                                       \
+        _mm256_storeu_pd ((block)->m2, vm2);                                    \
+    } while (0)
+
+__attribute__ ((target ("avx2")))
+static void _block_i16x4_avx2 (curve_block_t *block, const int16_t *data, size_t rows)
+{
+    CURVE_REDUCE_BLOCK_AVX2 (block, data, rows, _load_i16x4);
+}
+
+__attribute__ ((target ("avx2")))
+static void _block_i32x4_avx2 (curve_block_t *block, const int32_t *data, size_t rows)
+{
+    CURVE_REDUCE_BLOCK_AVX2 (block, data, rows, _load_i32x4);
+}
+#endif
+
+void curve_reduce_i16x4 (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES], const int16_t *data,
+        size_t rows)
+{
+    curve_block_t block;
+    for (size_t i = 0; i < rows; i += CURVE_REDUCE_BLOCK_ROWS) {
+        size_t n = (rows - i < CURVE_REDUCE_BLOCK_ROWS) ? rows - i : CURVE_REDUCE_BLOCK_ROWS;
+#ifdef CURVE_REDUCE_AVX2
+        if (cpu_has_avx2 ()) {
+            _block_i16x4_avx2 (&block, data + 4*i, n);
+        } else
+#endif
+        {
+            _block_i16x4_scalar (&block, data + 4*i, n);
+        }
+        _merge_block (stats, &block, n);
+    }
+}
+
+void curve_reduce_i32x4 (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES], const int32_t *data,
+        size_t rows)
+{
+    curve_block_t block;
+    for (size_t i = 0; i < rows; i += CURVE_REDUCE_BLOCK_ROWS) {
+        size_t n = (rows - i < CURVE_REDUCE_BLOCK_ROWS) ? rows - i : CURVE_REDUCE_BLOCK_ROWS;
+#ifdef CURVE_REDUCE_AVX2
+        if (cpu_has_avx2 ()) {
+            _block_i32x4_avx2 (&block, data + 4*i, n);
+        } else
+#endif
+        {
+            _block_i32x4_scalar (&block, data + 4*i, n);
+        }
+        _merge_block (stats, &block, n);
+    }
+}
+
+double curve_lane_stats_std (const curve_lane_stats_t *stats)
+{
+    return (stats->count > 0) ? sqrt (stats->m2/stats->count) : 0;
+}
+
+double curve_lane_stats_rms (const curve_lane_stats_t *stats)
+{
+    return (stats->count > 0) ? sqrt (stats->mean*stats->mean + stats->m2/stats->count) : 0;
+}
@@ -0,0 +1,38 @@
+#ifndef _CURVE_REDUCE_H_
+#define _CURVE_REDUCE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Per lane statistics of curves of 4 interleaved lanes, accumulated in a
+ * single pass over the data. Rows are taken in blocks: the sum, minimum
+ * and maximum of a block are exact integers, its sum of squared
+ * deviations is computed around the block mean while the block is still
+ * in cache and blocks are merged with the pairwise update of Chan et al.,
+ * so the variance does not suffer from the cancellation of sum of squares
+ * formulas. AVX2 is used where the CPU has it */
+
+#define CURVE_REDUCE_NUM_LANES      4
+
+typedef struct {
+    uint64_t count;
+    double mean;
+    /* Sum of squared deviations from the mean */
+    double m2;
+    int32_t min;
+    int32_t max;
+} curve_lane_stats_t;
+
+void curve_reduce_init (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES]);
+
+/* Add rows of int16x4 or int32x4 samples to stats */
+void curve_reduce_i16x4 (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES], const int16_t *data,
+        size_t rows);
+void curve_reduce_i32x4 (curve_lane_stats_t stats[CURVE_REDUCE_NUM_LANES], const int32_t *data,
+        size_t rows);
+
+/* Population standard deviation and root mean square of a lane */
+double curve_lane_stats_std (const curve_lane_stats_t *stats);
+double curve_lane_stats_rms (const curve_lane_stats_t *stats);
+
+#endif
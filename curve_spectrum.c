@@ -0,0 +1,170 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "curve_spectrum.h"
+
+/* Amplitude of a full scale sine of int16 samples */
+#define CURVE_SPECTRUM_FULL_SCALE   32768.0
+
+/* Bins claimed by DC, the carrier and the harmonics. Free bins are noise */
+enum {
+    BIN_NOISE = 0,
+    BIN_DC,
+    BIN_CARRIER,
+    BIN_HARMONIC
+};
+
+void curve_spectrum_plan_init (curve_spectrum_plan_t *plan)
+{
+    memset (plan, 0, sizeof (*plan));
+}
+
+void curve_spectrum_plan_destroy (curve_spectrum_plan_t *plan)
+{
+    curve_fft_plan_destroy (&plan->fft);
+    free (plan->window);
+    free (plan->x);
+    free (plan->power);
+    free (plan->mask);
+    curve_spectrum_plan_init (plan);
+}
+
+size_t curve_spectrum_size (size_t rows)
+{
+    return (rows < CURVE_SPECTRUM_MIN_SIZE) ? 0 : curve_fft_floor_size (rows);
+}
+
+static int _plan_setup (curve_spectrum_plan_t *plan, size_t size)
+{
+    curve_spectrum_plan_destroy (plan);
+    size_t half = size/2;
+
+    plan->window = malloc (size*sizeof (double));
+    plan->x = malloc (size*sizeof (double));
+    plan->power = malloc ((half + 1)*sizeof (double));
+    plan->mask = malloc (half + 1);
+    if (curve_fft_plan_setup (&plan->fft, size) < 0 || plan->window == NULL || plan->x == NULL ||
+            plan->power == NULL || plan->mask == NULL) {
+        curve_spectrum_plan_destroy (plan);
+        return -1;
+    }
+
+    /* Periodic 4 term Blackman-Harris window */
+    plan->window_power = 0;
+    for (size_t i = 0; i < size; i++) {
+        double t = 2*M_PI*i/size;
+        plan->window[i] = 0.35875 - 0.48829*cos (t) + 0.14128*cos (2*t) - 0.01168*cos (3*t);
+        plan->window_power += plan->window[i]*plan->window[i];
+    }
+
+    plan->size = size;
+    return 0;
+}
+
+/* Power spectrum, bins 0 to size/2, of the windowed lane of data */
+static void _lane_power (curve_spectrum_plan_t *plan, const int16_t *data, int lane)
+{
+    size_t size = plan->size;
+
+    double mean = 0;
+    for (size_t i = 0; i < size; i++) {
+        mean += data[4*i + lane];
+    }
+    mean /= size;
+
+    for (size_t i = 0; i < size; i++) {
+        plan->x[i] = (data[4*i + lane] - mean)*plan->window[i];
+    }
+    curve_fft_power (&plan->fft, plan->x, plan->power);
+}
+
+/* Claim the free bins of the main lobe around bin center for what. Returns
+ * their power and adds their power weighted by bin to *moment */
+static double _claim_lobe (curve_spectrum_plan_t *plan, long center, uint8_t what, double *moment)
+{
+    long half = (long) plan->size/2;
+    double power = 0;
+    for (long k = center - CURVE_SPECTRUM_LOBE_BINS; k <= center + CURVE_SPECTRUM_LOBE_BINS; k++) {
+        if (k < 0 || k > half || plan->mask[k] != BIN_NOISE) {
+            continue;
+        }
+        plan->mask[k] = what;
+        power += plan->power[k];
+        *moment += k*plan->power[k];
+    }
+    return power;
+}
+
+static void _lane_figures (curve_spectrum_plan_t *plan, double rate, curve_spectrum_t *result)
+{
+    size_t size = plan->size;
+    size_t half = size/2;
+    double moment = 0;
+
+    memset (plan->mask, BIN_NOISE, half + 1);
+    memset (plan->mask, BIN_DC, CURVE_SPECTRUM_LOBE_BINS + 1);
+
+    size_t peak = CURVE_SPECTRUM_LOBE_BINS + 1;
+    for (size_t k = peak; k <= half; k++) {
+        if (plan->power[k] > plan->power[peak]) {
+            peak = k;
+        }
+    }
+    double carrier = _claim_lobe (plan, peak, BIN_CARRIER, &moment);
+    double carrier_bin = (carrier > 0) ? moment/carrier : peak;
+
+    double harmonics = 0;
+    for (int h = 2; h <= CURVE_SPECTRUM_NUM_HARMONICS + 1; h++) {
+        double bin = fmod (h*carrier_bin, (double) size);
+        if (bin > half) {
+            bin = size - bin;
+        }
+        harmonics += _claim_lobe (plan, lround (bin), BIN_HARMONIC, &moment);
+    }
+
+    double noise = 0;
+    double spur = 0;
+    size_t noise_bins = 0;
+    for (size_t k = 0; k <= half; k++) {
+        if (plan->mask[k] == BIN_NOISE) {
+            noise += plan->power[k];
+            noise_bins++;
+        }
+        if ((plan->mask[k] == BIN_NOISE || plan->mask[k] == BIN_HARMONIC) && plan->power[k] > spur) {
+            spur = plan->power[k];
+        }
+    }
+    if (noise_bins > 0) {
+        noise *= (double) (half + 1)/noise_bins;
+    }
+
+    /* A sine of amplitude A puts A^2 size window_power/4 in the positive
+     * frequencies */
+    double amplitude2 = 4*carrier/(size*plan->window_power);
+
+    result->carrier_freq = carrier_bin*rate/size;
+    result->carrier_dbfs = 10*log10 (amplitude2/(CURVE_SPECTRUM_FULL_SCALE*CURVE_SPECTRUM_FULL_SCALE));
+    result->snr = 10*log10 (carrier/noise);
+    result->sfdr = 10*log10 (plan->power[peak]/spur);
+    result->thd = 10*log10 (harmonics/carrier);
+    result->sinad = 10*log10 (carrier/(noise + harmonics));
+    result->enob = (result->sinad - 1.76)/6.02;
+}
+
+int curve_spectrum_i16x4 (curve_spectrum_plan_t *plan, const int16_t *data, size_t rows,
+        double rate, curve_spectrum_t result[4])
+{
+    size_t size = curve_spectrum_size (rows);
+    if (size == 0) {
+        return -1;
+    }
+    if (plan->size != size && _plan_setup (plan, size) < 0) {
+        return -1;
+    }
+
+    for (int l = 0; l < 4; l++) {
+        _lane_power (plan, data, l);
+        _lane_figures (plan, rate, &result[l]);
+    }
+    return 0;
+}
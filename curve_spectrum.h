@@ -0,0 +1,66 @@
+#ifndef _CURVE_SPECTRUM_H_
+#define _CURVE_SPECTRUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "curve_fft.h"
+
+/* Spectral figures of merit of ADC captures: each lane of a curve of 4
+ * interleaved int16 lanes is stripped of its mean, windowed with a 4 term
+ * Blackman-Harris window and transformed with a real input FFT (see
+ * curve_fft.h).
+ *
+ * The carrier is the strongest bin above DC. Its power, and that of each
+ * harmonic, is summed over the main lobe of the window. Harmonics 2 to
+ * CURVE_SPECTRUM_NUM_HARMONICS + 1 are folded into the first Nyquist zone
+ * and make up the THD. The remaining bins are noise, scaled up to the
+ * whole band. SFDR is taken from the peak bins */
+
+/* Half width of the window main lobe [bins] */
+#define CURVE_SPECTRUM_LOBE_BINS    4
+#define CURVE_SPECTRUM_NUM_HARMONICS 5
+/* Smallest FFT size */
+#define CURVE_SPECTRUM_MIN_SIZE     64
+
+/* FFT plan, window and work buffers of one size, kept across curves so
+ * that repeated captures do not set them up again */
+typedef struct {
+    curve_fft_plan_t fft;
+    /* Real FFT size. 0 until the first curve */
+    size_t size;
+    double *window;
+    /* Sum of the squared window */
+    double window_power;
+    /* Work buffers */
+    double *x;
+    double *power;
+    uint8_t *mask;
+} curve_spectrum_plan_t;
+
+typedef struct {
+    /* Carrier frequency [Hz] and power relative to a full scale sine */
+    double carrier_freq;
+    double carrier_dbfs;
+    double snr;
+    double sfdr;
+    double thd;
+    double sinad;
+    double enob;
+} curve_spectrum_t;
+
+void curve_spectrum_plan_init (curve_spectrum_plan_t *plan);
+void curve_spectrum_plan_destroy (curve_spectrum_plan_t *plan);
+
+/* FFT size used for a curve of rows rows: the largest power of 2 not
+ * above rows, 0 if rows is below CURVE_SPECTRUM_MIN_SIZE */
+size_t curve_spectrum_size (size_t rows);
+
+/* Analyse the first curve_spectrum_size (rows) rows of each lane of data,
+ * sampled at rate [Hz], into result. The plan is set up again only if
+ * the FFT size changes. Returns -1 if rows is too small or on allocation
+ * failure */
+int curve_spectrum_i16x4 (curve_spectrum_plan_t *plan, const int16_t *data, size_t rows,
+        double rate, curve_spectrum_t result[4]);
+
+#endif
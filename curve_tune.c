@@ -0,0 +1,230 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "curve_tune.h"
+#include "cpu_feat.h"
+
+#ifdef CPU_FEAT_AVX2
+#define CURVE_TUNE_AVX2
+#include <immintrin.h>
+#endif
+
+/* Turns between two exact evaluations of the phasor of the Fourier
+ * transform. Within a block it is rotated, which drifts by about one
+ * rounding per turn */
+#define CURVE_TUNE_DTFT_BLOCK       256
+
+void curve_tune_plan_init (curve_tune_plan_t *plan)
+{
+    memset (plan, 0, sizeof (*plan));
+}
+
+void curve_tune_plan_destroy (curve_tune_plan_t *plan)
+{
+    curve_fft_plan_destroy (&plan->fft);
+    free (plan->window);
+    free (plan->x);
+    free (plan->power);
+    curve_tune_plan_init (plan);
+}
+
+static int _plan_setup (curve_tune_plan_t *plan, size_t turns)
+{
+    curve_tune_plan_destroy (plan);
+
+    /* Zero padded to the next power of 2 */
+    size_t size = curve_fft_floor_size (turns);
+    if (size < turns) {
+        size *= 2;
+    }
+    plan->window = malloc (turns*sizeof (double));
+    plan->x = calloc (size, sizeof (double));
+    plan->power = malloc ((size/2 + 1)*sizeof (double));
+    if (curve_fft_plan_setup (&plan->fft, size) < 0 || plan->window == NULL || plan->x == NULL ||
+            plan->power == NULL) {
+        curve_tune_plan_destroy (plan);
+        return -1;
+    }
+
+    plan->window_sum = 0;
+    for (size_t i = 0; i < turns; i++) {
+        plan->window[i] = 0.5 - 0.5*cos (2*M_PI*i/turns);
+        plan->window_sum += plan->window[i];
+    }
+
+    plan->turns = turns;
+    return 0;
+}
+
+/* e^(-2 pi i tune n) */
+static inline void _phasor (double tune, size_t n, double *re, double *im)
+{
+    double turns = fmod (tune*n, 1.0);
+    *re = cos (-2*M_PI*turns);
+    *im = sin (-2*M_PI*turns);
+}
+
+/* Fourier transform of the n points of x at tune */
+static void _dtft_scalar (const double *x, size_t n, double tune, double *re, double *im)
+{
+    double step_re, step_im;
+    _phasor (tune, 1, &step_re, &step_im);
+
+    double sum_re = 0;
+    double sum_im = 0;
+    for (size_t b = 0; b < n; b += CURVE_TUNE_DTFT_BLOCK) {
+        size_t end = (n - b < CURVE_TUNE_DTFT_BLOCK) ? n : b + CURVE_TUNE_DTFT_BLOCK;
+        double p_re, p_im;
+        _phasor (tune, b, &p_re, &p_im);
+        for (size_t i = b; i < end; i++) {
+            sum_re += x[i]*p_re;
+            sum_im += x[i]*p_im;
+            double t = p_re*step_re - p_im*step_im;
+            p_im = p_re*step_im + p_im*step_re;
+            p_re = t;
+        }
+    }
+    *re = sum_re;
+    *im = sum_im;
+}
+
+#ifdef CURVE_TUNE_AVX2
+/* Same, 4 turns per step, each with its own phasor rotated by 4 turns */
+__attribute__ ((target ("avx2")))
+static void _dtft_avx2 (const double *x, size_t n, double tune, double *re, double *im)
+{
+    double step_re, step_im;
+    _phasor (tune, 4, &step_re, &step_im);
+    const __m256d vstep_re = _mm256_set1_pd (step_re);
+    const __m256d vstep_im = _mm256_set1_pd (step_im);
+
+    __m256d sum_re = _mm256_setzero_pd ();
+    __m256d sum_im = _mm256_setzero_pd ();
+    size_t n4 = n/4*4;
+    for (size_t b = 0; b < n4; b += CURVE_TUNE_DTFT_BLOCK) {
+        size_t end = (n4 - b < CURVE_TUNE_DTFT_BLOCK) ? n4 : b + CURVE_TUNE_DTFT_BLOCK;
+        double p_re[4], p_im[4];
+        for (int j = 0; j < 4; j++) {
+            _phasor (tune, b + j, &p_re[j], &p_im[j]);
+        }
+        __m256d vp_re = _mm256_loadu_pd (p_re);
+        __m256d vp_im = _mm256_loadu_pd (p_im);
+        for (size_t i = b; i < end; i += 4) {
+            __m256d v = _mm256_loadu_pd (x + i);
+            sum_re = _mm256_add_pd (sum_re, _mm256_mul_pd (v, vp_re));
+            sum_im = _mm256_add_pd (sum_im, _mm256_mul_pd (v, vp_im));
+            __m256d t = _mm256_sub_pd (_mm256_mul_pd (vp_re, vstep_re), _mm256_mul_pd (vp_im, vstep_im));
+            vp_im = _mm256_add_pd (_mm256_mul_pd (vp_re, vstep_im), _mm256_mul_pd (vp_im, vstep_re));
+            vp_re = t;
+        }
+    }
+
+    double s_re[4], s_im[4];
+    _mm256_storeu_pd (s_re, sum_re);
+    _mm256_storeu_pd (s_im, sum_im);
+
+    /* Fewer than 4 turns left */
+    double tail_re = 0, tail_im = 0;
+    for (size_t i = n4; i < n; i++) {
+        double p_re, p_im;
+        _phasor (tune, i, &p_re, &p_im);
+        tail_re += x[i]*p_re;
+        tail_im += x[i]*p_im;
+    }
+    *re = (s_re[0] + s_re[1]) + (s_re[2] + s_re[3]) + tail_re;
+    *im = (s_im[0] + s_im[1]) + (s_im[2] + s_im[3]) + tail_im;
+}
+#endif
+
+static void _dtft (const double *x, size_t n, double tune, double *re, double *im)
+{
+#ifdef CURVE_TUNE_AVX2
+    if (cpu_has_avx2 ()) {
+        _dtft_avx2 (x, n, tune, re, im);
+        return;
+    }
+#endif
+    _dtft_scalar (x, n, tune, re, im);
+}
+
+static double _dtft_power (const double *x, size_t n, double tune)
+{
+    double re, im;
+    _dtft (x, n, tune, &re, &im);
+    return re*re + im*im;
+}
+
+int curve_tune_i32x4 (curve_tune_plan_t *plan, const int32_t *data, size_t turns, int lane,
+        curve_tune_t *result)
+{
+    if (turns < CURVE_TUNE_MIN_TURNS) {
+        return -1;
+    }
+    if (plan->turns != turns && _plan_setup (plan, turns) < 0) {
+        return -1;
+    }
+
+    double mean = 0;
+    for (size_t i = 0; i < turns; i++) {
+        mean += data[4*i + lane];
+    }
+    mean /= turns;
+    for (size_t i = 0; i < turns; i++) {
+        plan->x[i] = (data[4*i + lane] - mean)*plan->window[i];
+    }
+
+    /* Strongest line above the DC lobe of the window */
+    size_t size = plan->fft.size;
+    curve_fft_power (&plan->fft, plan->x, plan->power);
+    size_t peak = 2;
+    for (size_t k = peak; k <= size/2; k++) {
+        if (plan->power[k] > plan->power[peak]) {
+            peak = k;
+        }
+    }
+
+    /* Golden section search over the bins next to it */
+    const double ratio = (sqrt (5.0) - 1)/2;
+    double lo = (peak - 1.0)/size;
+    double hi = (peak + 1.0 < size/2) ? (peak + 1.0)/size : 0.5;
+    double a = hi - ratio*(hi - lo);
+    double b = lo + ratio*(hi - lo);
+    double power_a = _dtft_power (plan->x, turns, a);
+    double power_b = _dtft_power (plan->x, turns, b);
+    for (int step = 0; step < CURVE_TUNE_SEARCH_STEPS; step++) {
+        if (power_a > power_b) {
+            hi = b;
+            b = a;
+            power_b = power_a;
+            a = hi - ratio*(hi - lo);
+            power_a = _dtft_power (plan->x, turns, a);
+        } else {
+            lo = a;
+            a = b;
+            power_a = power_b;
+            b = lo + ratio*(hi - lo);
+            power_b = _dtft_power (plan->x, turns, b);
+        }
+    }
+
+    double re, im;
+    result->tune = (lo + hi)/2;
+    _dtft (plan->x, turns, result->tune, &re, &im);
+    result->amplitude = 2*sqrt (re*re + im*im)/plan->window_sum;
+    result->phase = atan2 (im, re);
+
+    /* Variance left once the line is taken out */
+    double total = 0;
+    double residual = 0;
+    for (size_t i = 0; i < turns; i++) {
+        double v = data[4*i + lane] - mean;
+        double r = v - result->amplitude*cos (2*M_PI*fmod (result->tune*i, 1.0) + result->phase);
+        total += v*v;
+        residual += r*r;
+    }
+    result->confidence = (total > 0) ? 1 - residual/total : 0;
+    if (result->confidence < 0) {
+        result->confidence = 0;
+    }
+    return 0;
+}
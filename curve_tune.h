@@ -0,0 +1,57 @@
+#ifndef _CURVE_TUNE_H_
+#define _CURVE_TUNE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "curve_fft.h"
+
+/* Fractional betatron tune of turn by turn positions, NAFF style: the
+ * turns, stripped of their mean, are windowed with a Hann window. The
+ * strongest line of their FFT, zero padded to a power of 2, is then
+ * refined by a golden section search for the maximum of the windowed
+ * Fourier transform of all the turns around it, evaluated with AVX2 where
+ * the CPU has it. Amplitude and phase are those of the refined line. The
+ * confidence is the fraction of the variance of the turns that the line
+ * explains: near 1 for a clean oscillation, near 0 for noise */
+
+/* Fewest turns analysed */
+#define CURVE_TUNE_MIN_TURNS        64
+/* Golden section steps: the search interval, 2 FFT bins wide, shrinks by
+ * 0.618 per step */
+#define CURVE_TUNE_SEARCH_STEPS     60
+
+/* Window, FFT plan and work buffers, kept across curves so that repeated
+ * captures do not set them up again */
+typedef struct {
+    curve_fft_plan_t fft;
+    /* Turns the window is set up for. 0 until the first curve */
+    size_t turns;
+    double *window;
+    /* Sum of the window */
+    double window_sum;
+    /* Work buffers: the windowed turns and the FFT power */
+    double *x;
+    double *power;
+} curve_tune_plan_t;
+
+typedef struct {
+    /* Fractional tune, between 0 and 0.5 */
+    double tune;
+    /* Amplitude, in the unit of the positions, and phase [rad] at the
+     * first turn of a cosine */
+    double amplitude;
+    double phase;
+    double confidence;
+} curve_tune_t;
+
+void curve_tune_plan_init (curve_tune_plan_t *plan);
+void curve_tune_plan_destroy (curve_tune_plan_t *plan);
+
+/* Estimate the tune of lane of turns rows of 4 interleaved int32 lanes.
+ * Returns -1 if turns is below CURVE_TUNE_MIN_TURNS or on allocation
+ * failure */
+int curve_tune_i32x4 (curve_tune_plan_t *plan, const int32_t *data, size_t turns, int lane,
+        curve_tune_t *result);
+
+#endif
@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+
+# Check that the client and the mock server understand each other.
+#
+# The mock speaks the HALCS/ACQ protocol as the client libraries are
+# expected to frame it. This starts the mock on a private endpoint and
+# checks that a register round trip and a full acquisition spanning
+# several data blocks, the last one partial, come through intact.
+# Exits with 0 when they do.
+
+set -u
+
+# Defaults
+CLIENT=./client
+MOCK=mock/halcs_mock
+# Samples of the checked acquisition: several data blocks, the last one partial
+SAMPLES=100000
+KX=12345678
+
+usage() {
+    echo "Usage: $0 [options]"
+    echo "  -c <client>          Client program (default ${CLIENT})"
+    echo "  -m <mock>            Mock server (default ${MOCK})"
+}
+
+while getopts "hc:m:" opt; do
+    case ${opt} in
+        c) CLIENT=${OPTARG} ;;
+        m) MOCK=${OPTARG} ;;
+        h) usage; exit 0 ;;
+        *) usage; exit 1 ;;
+    esac
+done
+
+TMP_DIR=$(mktemp -d)
+ENDPOINT="ipc://${TMP_DIR}/broker"
+MOCK_PID=
+
+cleanup() {
+    if [ -n "${MOCK_PID}" ]; then
+        kill -TERM ${MOCK_PID} 2>/dev/null
+        wait ${MOCK_PID} 2>/dev/null
+    fi
+    rm -rf "${TMP_DIR}"
+}
+trap cleanup EXIT
+
+# Fail the check with message
+check_failed() {
+    echo "$0: the client and the mock server do not agree: $1" >&2
+    exit 1
+}
+
+"${MOCK}" -e "${ENDPOINT}" -d 0 -m 0 > "${TMP_DIR}/mock.log" 2>&1 &
+MOCK_PID=$!
+
+for ((i = 0; i < 50; i++)); do
+    grep -q "Serving" "${TMP_DIR}/mock.log" 2>/dev/null && break
+    sleep 0.1
+done
+if ! grep -q "Serving" "${TMP_DIR}/mock.log" 2>/dev/null; then
+    echo "$0: mock server did not start:" >&2
+    cat "${TMP_DIR}/mock.log" >&2
+    exit 1
+fi
+
+CLIENT_ARGS="-e ${ENDPOINT} -d 0 -m 0"
+
+out=$("${CLIENT}" ${CLIENT_ARGS} --setkx ${KX} --getkx 2>&1) ||
+    check_failed "--setkx/--getkx failed: ${out}"
+echo "${out}" | grep -q ": ${KX}\$" ||
+    check_failed "--getkx did not read back ${KX}: ${out}"
+
+args="-H 0 --setsamplespre ${SAMPLES} --setsamplespost 0 --setnumshots 1 --fullacq"
+bytes=$("${CLIENT}" ${CLIENT_ARGS} ${args} --filefmt 1 2>/dev/null | wc -c)
+[ "${bytes}" -eq $((SAMPLES*8)) ] ||
+    check_failed "binary --fullacq of ${SAMPLES} ADC samples gave ${bytes} bytes"
+bytes=$("${CLIENT}" ${CLIENT_ARGS} ${args} --filefmt 1 --stream 2>/dev/null | wc -c)
+[ "${bytes}" -eq $((SAMPLES*8)) ] ||
+    check_failed "binary --fullacq --stream of ${SAMPLES} ADC samples gave ${bytes} bytes"
+lines=$("${CLIENT}" ${CLIENT_ARGS} ${args} 2>/dev/null | wc -l)
+[ "${lines}" -eq ${SAMPLES} ] ||
+    check_failed "text --fullacq of ${SAMPLES} ADC samples gave ${lines} lines"
+
+echo "$0: the client and the mock server agree" >&2
@@ -0,0 +1,797 @@
+/* HALCS/ACQ mock server.
+ *
+ * Runs a Malamute broker and, for every board/bpm given, a worker per
+ * FMC130M_4CH, FMC_ADC_COMMON, FMC_ACTIVE_CLK, DSP, SWAP, RFFE and ACQ
+ * service, so that the client can be exercised and benchmarked without
+ * hardware.
+ *
+ * Requests follow the halcs_client framing: the operation code, as given by
+ * halcs_func_translate, followed by one frame per function argument. Replies
+ * are the status word, optionally followed by the size and the contents of
+ * the value read. Register functions (rw flag followed by the value) store
+ * what is written and return it when read. The ACQ service keeps the last
+ * acquisition request and answers data blocks, in the smio_acq_data_block_t
+ * layout (valid bytes followed by the data), with synthetic curves:
+ *
+ *   ADC             4 antennas, sine at --adcfreq with a small dither
+ *   IQ              I/Q pairs of the same carrier
+ *   Amplitude       A, B, C, D of a beam doing betatron oscillations at
+ *                   --tunex and --tuney, --posamp [nm] peak
+ *   Phase           Constant phase per antenna plus noise
+ *   Position        X, Y, Q and Sum of that same beam
+ *
+ * Every request is answered after --latency [us] plus the reply size over
+ * --bandwidth [MB/s].
+ *
+ * The framing, status words and block size above are what the client
+ * libraries are expected to use. mock/check_mock.sh checks them with a
+ * register round trip and a full acquisition of several blocks */
+
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malamute.h>
+#include <acq_client.h>
+#include <halcs_client.h>
+
+#include "acq_stream.h"
+
+#define MOCK_DFLT_BROKER            "ipc:///tmp/bpm"
+#define MOCK_DFLT_ACQ_TIME_US       2000
+#define MOCK_DFLT_MAX_SAMPLES       (1 << 28)
+#define MOCK_DFLT_ADC_FREQ          0.2096
+#define MOCK_DFLT_TUNE_X            0.2273
+#define MOCK_DFLT_TUNE_Y            0.1391
+#define MOCK_DFLT_POS_AMP           100000.0
+#define MOCK_DFLT_SUM               4.0e6
+#define MOCK_DFLT_ADC_AMP           20000.0
+/* DSP defaults: Kx and Ky [nm], Ksum fixed point with 24 fractional bits */
+#define MOCK_DFLT_KX                10000000
+#define MOCK_DFLT_KY                10000000
+#define MOCK_DFLT_KSUM              (1 << 24)
+
+#define MOCK_MAX_NUM_BOARDS         64
+#define MOCK_MAX_NUM_BPMS           16
+#define MOCK_MAX_FUNCS              32
+/* Largest argument or value: 8 words */
+#define MOCK_MAX_VAL_SIZE           32
+#define MOCK_SERVICE_MAX_LEN        64
+#define MOCK_POLL_MS                100
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+/* Reply status words */
+#define MOCK_REPLY_OK               0
+#define MOCK_REPLY_ERR              1
+#define MOCK_REPLY_NOT_COMPLETED    2
+
+typedef enum {
+    MOD_FMC130M_4CH = 0,
+    MOD_FMC_ADC_COMMON,
+    MOD_FMC_ACTIVE_CLK,
+    MOD_DSP,
+    MOD_SWAP,
+    MOD_RFFE,
+    MOD_ACQ,
+    END_MOD
+} mock_module_e;
+
+static const struct {
+    const char *name;
+    const char *funcs[MOCK_MAX_FUNCS];
+} mock_modules[END_MOD] = {
+    [MOD_FMC130M_4CH] = {"FMC130M_4CH", {
+        FMC130M_4CH_NAME_ADC_DATA0, FMC130M_4CH_NAME_ADC_DITH, FMC130M_4CH_NAME_ADC_DLY0,
+        FMC130M_4CH_NAME_ADC_DLY_LINE0, FMC130M_4CH_NAME_ADC_DLY_UPDT0,
+        FMC130M_4CH_NAME_ADC_DLY_VAL0, FMC130M_4CH_NAME_ADC_PGA, FMC130M_4CH_NAME_ADC_RAND,
+        FMC130M_4CH_NAME_ADC_SHDN, NULL}},
+    [MOD_FMC_ADC_COMMON] = {"FMC_ADC_COMMON", {
+        FMC_ADC_COMMON_NAME_LEDS, FMC_ADC_COMMON_NAME_TEST_DATA_EN, FMC_ADC_COMMON_NAME_TRIG_DIR,
+        FMC_ADC_COMMON_NAME_TRIG_TERM, FMC_ADC_COMMON_NAME_TRIG_VAL, NULL}},
+    [MOD_FMC_ACTIVE_CLK] = {"FMC_ACTIVE_CLK", {
+        FMC_ACTIVE_CLK_NAME_AD9510_CFG_DEFAULTS, FMC_ACTIVE_CLK_NAME_AD9510_CP_CURRENT,
+        FMC_ACTIVE_CLK_NAME_AD9510_MUX_STATUS, FMC_ACTIVE_CLK_NAME_AD9510_OUTPUTS,
+        FMC_ACTIVE_CLK_NAME_AD9510_PLL_A_DIV, FMC_ACTIVE_CLK_NAME_AD9510_PLL_B_DIV,
+        FMC_ACTIVE_CLK_NAME_AD9510_PLL_CLK_SEL, FMC_ACTIVE_CLK_NAME_AD9510_PLL_PDOWN,
+        FMC_ACTIVE_CLK_NAME_AD9510_PLL_PRESCALER, FMC_ACTIVE_CLK_NAME_AD9510_R_DIV,
+        FMC_ACTIVE_CLK_NAME_CLK_SEL, FMC_ACTIVE_CLK_NAME_PLL_FUNCTION,
+        FMC_ACTIVE_CLK_NAME_PLL_STATUS, FMC_ACTIVE_CLK_NAME_SI571_FREQ,
+        FMC_ACTIVE_CLK_NAME_SI571_GET_DEFAULTS, FMC_ACTIVE_CLK_NAME_SI571_OE, NULL}},
+    [MOD_DSP] = {"DSP", {
+        DSP_NAME_SET_GET_DS_FOFB_THRES, DSP_NAME_SET_GET_DS_MONIT_THRES,
+        DSP_NAME_SET_GET_DS_TBT_THRES, DSP_NAME_SET_GET_KSUM, DSP_NAME_SET_GET_KX,
+        DSP_NAME_SET_GET_KY, DSP_NAME_SET_GET_MONIT_AMP_CH0, DSP_NAME_SET_GET_MONIT_POS_Q,
+        DSP_NAME_SET_GET_MONIT_POS_SUM, DSP_NAME_SET_GET_MONIT_POS_X,
+        DSP_NAME_SET_GET_MONIT_POS_Y, NULL}},
+    [MOD_SWAP] = {"SWAP", {
+        SWAP_NAME_SET_GET_DIV_CLK, SWAP_NAME_SET_GET_SW, SWAP_NAME_SET_GET_SW_DLY, NULL}},
+    [MOD_RFFE] = {"RFFE", {
+        RFFE_NAME_SET_GET_ATT, RFFE_NAME_SET_GET_HEATER_AC, RFFE_NAME_SET_GET_REPROG,
+        RFFE_NAME_SET_GET_RESET, RFFE_NAME_SET_GET_SET_POINT_AC, RFFE_NAME_SET_GET_TEMP_AC,
+        RFFE_NAME_SET_GET_TEMP_CONTROL, NULL}},
+    [MOD_ACQ] = {"ACQ", {
+        ACQ_NAME_DATA_ACQUIRE, ACQ_NAME_CHECK_DATA_ACQUIRE, ACQ_NAME_GET_DATA_BLOCK,
+        ACQ_NAME_CFG_TRIG, ACQ_NAME_FSM_STOP, ACQ_NAME_HW_DATA_TRIG_CHAN,
+        ACQ_NAME_HW_DATA_TRIG_FILT, ACQ_NAME_HW_DATA_TRIG_POL, ACQ_NAME_HW_DATA_TRIG_SEL,
+        ACQ_NAME_HW_DATA_TRIG_THRES, ACQ_NAME_HW_TRIG_DLY, ACQ_NAME_SW_TRIG, NULL}},
+};
+
+/* How the curves of each channel are synthesized */
+typedef enum {
+    SYNTH_ADC = 0,
+    SYNTH_IQ,
+    SYNTH_AMP,
+    SYNTH_PHASE,
+    SYNTH_POS
+} mock_synth_e;
+
+static const mock_synth_e mock_chan_synth[END_CHAN_ID] = {
+    [0] = SYNTH_ADC,    [1] = SYNTH_ADC,    [2] = SYNTH_IQ,     [3] = SYNTH_IQ,
+    [4] = SYNTH_IQ,     [5] = SYNTH_IQ,     [6] = SYNTH_AMP,    [7] = SYNTH_PHASE,
+    [8] = SYNTH_POS,    [9] = SYNTH_IQ,     [10] = SYNTH_IQ,    [11] = SYNTH_AMP,
+    [12] = SYNTH_PHASE, [13] = SYNTH_POS,   [14] = SYNTH_AMP,   [15] = SYNTH_PHASE,
+    [16] = SYNTH_POS
+};
+
+typedef struct {
+    char *broker_endp;
+    uint32_t board_list[MOCK_MAX_NUM_BOARDS];
+    uint32_t num_boards;
+    uint32_t bpm_list[MOCK_MAX_NUM_BPMS];
+    uint32_t num_bpms;
+    int verbose;
+    /* Fixed cost of every request [us] and reply bandwidth [MB/s], 0 for
+     * unlimited */
+    int64_t latency_us;
+    double bandwidth;
+    /* Time from acq_start until the data is ready [us] */
+    int64_t acq_time_us;
+    uint64_t max_samples;
+    /* Bytes per sample of each channel: 8 (int16x4) or 16 (int32x4) */
+    uint32_t sample_size[END_CHAN_ID];
+    double adc_freq;
+    double tune_x;
+    double tune_y;
+    double pos_amp;
+} mock_cfg_t;
+
+typedef struct {
+    const disp_op_t *op;
+    uint8_t value[MOCK_MAX_VAL_SIZE];
+} mock_reg_t;
+
+typedef struct {
+    const mock_cfg_t *cfg;
+    mock_module_e module;
+    char service[MOCK_SERVICE_MAX_LEN];
+    pthread_t thread;
+    mlm_client_t *mlm_client;
+    mock_reg_t regs[MOCK_MAX_FUNCS];
+    uint32_t num_regs;
+
+    /* ACQ service state */
+    uint32_t acq_opcode_start;
+    uint32_t acq_opcode_check;
+    uint32_t acq_opcode_block;
+    uint32_t acq_opcode_stop;
+    int acq_armed;
+    int64_t acq_start_us;
+    acq_req_t acq_req;
+    uint8_t *block;
+} mock_service_t;
+
+static volatile int mock_stop;
+
+static void _mock_delay (const mock_cfg_t *cfg, size_t bytes)
+{
+    int64_t us = cfg->latency_us;
+    if (cfg->bandwidth > 0) {
+        us += (int64_t) (bytes/cfg->bandwidth);
+    }
+    if (us > 0) {
+        usleep (us);
+    }
+}
+
+static mock_reg_t *_mock_reg_find (mock_service_t *service, uint32_t opcode)
+{
+    for (uint32_t i = 0; i < service->num_regs; i++) {
+        if (service->regs[i].op->opcode == opcode) {
+            return &service->regs[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t _mock_opcode (const char *name)
+{
+    const disp_op_t *op = halcs_func_translate ((char *) name);
+    return (op != NULL) ? op->opcode : UINT32_MAX;
+}
+
+static void _mock_reg_set_u32 (mock_service_t *service, const char *name, uint32_t value)
+{
+    mock_reg_t *reg = _mock_reg_find (service, _mock_opcode (name));
+    if (reg != NULL) {
+        memcpy (reg->value, &value, sizeof (value));
+    }
+}
+
+static int _mock_service_init (mock_service_t *service, const mock_cfg_t *cfg,
+        mock_module_e module, uint32_t board, uint32_t bpm)
+{
+    memset (service, 0, sizeof (*service));
+    service->cfg = cfg;
+    service->module = module;
+    snprintf (service->service, sizeof (service->service), "HALCS%u:DEVIO:%s%u", board,
+            mock_modules[module].name, bpm);
+
+    for (const char * const *name = mock_modules[module].funcs; *name != NULL; name++) {
+        const disp_op_t *op = halcs_func_translate ((char *) *name);
+        if (op == NULL) {
+            fprintf (stderr, "[halcs_mock]: Unknown function %s, skipping it\n", *name);
+            continue;
+        }
+        service->regs[service->num_regs++].op = op;
+    }
+
+    if (module == MOD_DSP) {
+        _mock_reg_set_u32 (service, DSP_NAME_SET_GET_KX, MOCK_DFLT_KX);
+        _mock_reg_set_u32 (service, DSP_NAME_SET_GET_KY, MOCK_DFLT_KY);
+        _mock_reg_set_u32 (service, DSP_NAME_SET_GET_KSUM, MOCK_DFLT_KSUM);
+    }
+    else if (module == MOD_ACQ) {
+        service->acq_opcode_start = _mock_opcode (ACQ_NAME_DATA_ACQUIRE);
+        service->acq_opcode_check = _mock_opcode (ACQ_NAME_CHECK_DATA_ACQUIRE);
+        service->acq_opcode_block = _mock_opcode (ACQ_NAME_GET_DATA_BLOCK);
+        service->acq_opcode_stop = _mock_opcode (ACQ_NAME_FSM_STOP);
+        service->block = malloc (sizeof (uint32_t) + ACQ_STREAM_BLOCK_SIZE);
+        if (service->block == NULL) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void _mock_service_destroy (mock_service_t *service)
+{
+    free (service->block);
+    service->block = NULL;
+}
+
+/* Deterministic noise in [-0.5, 0.5) */
+static double _mock_noise (uint32_t chan, uint64_t n, uint32_t lane)
+{
+    uint64_t x = (n*4 + lane)*0x9E3779B97F4A7C15ULL + chan;
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 29;
+    return (x >> 11)*(1.0/9007199254740992.0) - 0.5;
+}
+
+/* Antenna amplitudes of a beam at (x, y) [nm], such that the difference
+ * over sum formulas with Kx/Ky give x and y back */
+static void _mock_antennas (const mock_cfg_t *cfg, uint64_t n, double *amp)
+{
+    double u = cfg->pos_amp*cos (2*M_PI*cfg->tune_x*n)/MOCK_DFLT_KX;
+    double v = cfg->pos_amp*cos (2*M_PI*cfg->tune_y*n)/MOCK_DFLT_KY;
+
+    amp[0] = MOCK_DFLT_SUM/4*(1 + u + v);
+    amp[1] = MOCK_DFLT_SUM/4*(1 - u + v);
+    amp[2] = MOCK_DFLT_SUM/4*(1 - u - v);
+    amp[3] = MOCK_DFLT_SUM/4*(1 + u - v);
+}
+
+static void _mock_synth_sample (const mock_cfg_t *cfg, uint32_t chan, uint64_t n, int32_t *lanes)
+{
+    double amp[4];
+
+    switch (mock_chan_synth[chan]) {
+        case SYNTH_ADC:
+            _mock_antennas (cfg, n, amp);
+            for (uint32_t l = 0; l < 4; l++) {
+                lanes[l] = (int32_t) lrint (MOCK_DFLT_ADC_AMP*amp[l]/(MOCK_DFLT_SUM/4)*
+                        sin (2*M_PI*cfg->adc_freq*n + 0.5*l) + 8*_mock_noise (chan, n, l));
+            }
+            break;
+
+        case SYNTH_IQ:
+            _mock_antennas (cfg, n, amp);
+            for (uint32_t l = 0; l < 4; l += 2) {
+                lanes[l] = (int32_t) lrint (amp[l]*cos (0.5*l) + 16*_mock_noise (chan, n, l));
+                lanes[l+1] = (int32_t) lrint (amp[l]*sin (0.5*l) + 16*_mock_noise (chan, n, l+1));
+            }
+            break;
+
+        case SYNTH_AMP:
+            _mock_antennas (cfg, n, amp);
+            for (uint32_t l = 0; l < 4; l++) {
+                lanes[l] = (int32_t) lrint (amp[l] + 16*_mock_noise (chan, n, l));
+            }
+            break;
+
+        case SYNTH_PHASE:
+            for (uint32_t l = 0; l < 4; l++) {
+                lanes[l] = (int32_t) lrint (1000*l + 32*_mock_noise (chan, n, l));
+            }
+            break;
+
+        case SYNTH_POS:
+            lanes[0] = (int32_t) lrint (cfg->pos_amp*cos (2*M_PI*cfg->tune_x*n) +
+                    100*_mock_noise (chan, n, 0));
+            lanes[1] = (int32_t) lrint (cfg->pos_amp*cos (2*M_PI*cfg->tune_y*n) +
+                    100*_mock_noise (chan, n, 1));
+            lanes[2] = (int32_t) lrint (100*_mock_noise (chan, n, 2));
+            lanes[3] = (int32_t) lrint (MOCK_DFLT_SUM + 16*_mock_noise (chan, n, 3));
+            break;
+    }
+}
+
+/* Fill data with size bytes of channel chan, starting at sample first */
+static void _mock_synth (const mock_cfg_t *cfg, uint32_t chan, uint64_t first, uint8_t *data,
+        uint32_t size)
+{
+    uint32_t sample_size = cfg->sample_size[chan];
+    int32_t lanes[4];
+
+    for (uint32_t i = 0; i < size/sample_size; i++) {
+        _mock_synth_sample (cfg, chan, first + i, lanes);
+        if (sample_size == 4*sizeof (int16_t)) {
+            int16_t *dst = (int16_t *) (data + i*sample_size);
+            for (uint32_t l = 0; l < 4; l++) {
+                dst[l] = (lanes[l] > INT16_MAX) ? INT16_MAX :
+                    (lanes[l] < INT16_MIN) ? INT16_MIN : lanes[l];
+            }
+        } else {
+            memcpy (data + i*sample_size, lanes, sizeof (lanes));
+        }
+    }
+}
+
+static void _mock_reply (mock_service_t *service, uint32_t status, const void *data, uint32_t size)
+{
+    zmsg_t *reply = zmsg_new ();
+    if (reply == NULL) {
+        return;
+    }
+
+    zmsg_addmem (reply, &status, sizeof (status));
+    if (data != NULL) {
+        zmsg_addmem (reply, &size, sizeof (size));
+        zmsg_addmem (reply, data, size);
+    }
+
+    _mock_delay (service->cfg, (data != NULL) ? size : 0);
+    mlm_client_sendto (service->mlm_client, mlm_client_sender (service->mlm_client), NULL, NULL,
+            0, &reply);
+}
+
+/* Argument frames as 32-bit words, as many as fit in args, which must be
+ * zeroed */
+static uint32_t _mock_pop_args (zmsg_t *msg, uint32_t *args, uint32_t max_words)
+{
+    uint32_t words = 0;
+    zframe_t *frame;
+
+    while ((frame = zmsg_pop (msg)) != NULL) {
+        size_t size = zframe_size (frame);
+        if (size > (max_words - words)*sizeof (uint32_t)) {
+            size = (max_words - words)*sizeof (uint32_t);
+        }
+        memcpy (args + words, zframe_data (frame), size);
+        words += (size + sizeof (uint32_t) - 1)/sizeof (uint32_t);
+        zframe_destroy (&frame);
+    }
+    return words;
+}
+
+static void _mock_handle_acq (mock_service_t *service, uint32_t opcode, const uint32_t *args,
+        uint32_t num_args)
+{
+    const mock_cfg_t *cfg = service->cfg;
+
+    if (opcode == service->acq_opcode_start) {
+        /* num_samples_pre, num_samples_post, num_shots, chan */
+        acq_req_t req = {
+            .num_samples_pre = args[0],
+            .num_samples_post = args[1],
+            .num_shots = args[2],
+            .chan = args[3]
+        };
+        uint64_t samples = (uint64_t) (req.num_samples_pre + req.num_samples_post)*req.num_shots;
+        if (num_args < 4 || req.chan >= END_CHAN_ID || samples == 0 || samples > cfg->max_samples) {
+            _mock_reply (service, MOCK_REPLY_ERR, NULL, 0);
+            return;
+        }
+
+        service->acq_req = req;
+        service->acq_armed = 1;
+        service->acq_start_us = zclock_usecs ();
+        _mock_reply (service, MOCK_REPLY_OK, NULL, 0);
+    }
+    else if (opcode == service->acq_opcode_check) {
+        uint32_t status = !service->acq_armed ? MOCK_REPLY_ERR :
+            (zclock_usecs () - service->acq_start_us < cfg->acq_time_us) ?
+            MOCK_REPLY_NOT_COMPLETED : MOCK_REPLY_OK;
+        _mock_reply (service, status, NULL, 0);
+    }
+    else if (opcode == service->acq_opcode_block) {
+        /* chan, block number */
+        uint32_t chan = args[0];
+        uint32_t block_n = args[1];
+        const acq_req_t *req = &service->acq_req;
+
+        if (num_args < 2 || !service->acq_armed || chan != req->chan ||
+                zclock_usecs () - service->acq_start_us < cfg->acq_time_us) {
+            _mock_reply (service, MOCK_REPLY_ERR, NULL, 0);
+            return;
+        }
+
+        uint32_t sample_size = cfg->sample_size[chan];
+        uint64_t total = (uint64_t) (req->num_samples_pre + req->num_samples_post)*
+            req->num_shots*sample_size;
+        /* Blocks always hold whole samples */
+        uint32_t block_size = ACQ_STREAM_BLOCK_SIZE - ACQ_STREAM_BLOCK_SIZE % sample_size;
+        uint64_t offset = (uint64_t) block_n*block_size;
+        if (offset >= total) {
+            _mock_reply (service, MOCK_REPLY_ERR, NULL, 0);
+            return;
+        }
+
+        uint32_t valid_bytes = (total - offset < block_size) ? total - offset : block_size;
+        memcpy (service->block, &valid_bytes, sizeof (valid_bytes));
+        _mock_synth (cfg, chan, offset/sample_size, service->block + sizeof (valid_bytes),
+                valid_bytes);
+        _mock_reply (service, MOCK_REPLY_OK, service->block, sizeof (valid_bytes) + valid_bytes);
+    }
+    else {
+        if (opcode == service->acq_opcode_stop) {
+            service->acq_armed = 0;
+        }
+        _mock_reply (service, MOCK_REPLY_OK, NULL, 0);
+    }
+}
+
+static void _mock_handle (mock_service_t *service, zmsg_t *msg)
+{
+    uint32_t args[MOCK_MAX_VAL_SIZE/sizeof (uint32_t)*4] = {0};
+    uint32_t opcode;
+
+    zframe_t *opcode_frame = zmsg_pop (msg);
+    if (opcode_frame == NULL || zframe_size (opcode_frame) != sizeof (opcode)) {
+        zframe_destroy (&opcode_frame);
+        _mock_reply (service, MOCK_REPLY_ERR, NULL, 0);
+        return;
+    }
+    memcpy (&opcode, zframe_data (opcode_frame), sizeof (opcode));
+    zframe_destroy (&opcode_frame);
+
+    uint32_t num_args = _mock_pop_args (msg, args, ARRAY_SIZE (args));
+    mock_reg_t *reg = _mock_reg_find (service, opcode);
+
+    if (service->cfg->verbose) {
+        printf ("[halcs_mock]: %s: %s\n", service->service, (reg != NULL) ? reg->op->name : "?");
+    }
+
+    if (reg == NULL) {
+        _mock_reply (service, MOCK_REPLY_ERR, NULL, 0);
+        return;
+    }
+
+    if (service->module == MOD_ACQ && (opcode == service->acq_opcode_start ||
+                opcode == service->acq_opcode_check || opcode == service->acq_opcode_block ||
+                opcode == service->acq_opcode_stop)) {
+        _mock_handle_acq (service, opcode, args, num_args);
+        return;
+    }
+
+    /* Register functions take the rw flag (0 to write) and the value.
+     * Anything else is a command */
+    uint32_t value_size = DISP_GET_ASIZE (reg->op->retval);
+    value_size = (value_size > MOCK_MAX_VAL_SIZE) ? MOCK_MAX_VAL_SIZE : value_size;
+    int has_rw = reg->op->args[0] != DISP_ARG_END && reg->op->args[1] != DISP_ARG_END;
+
+    if (has_rw && args[0] == 0) {
+        uint32_t arg_size = DISP_GET_ASIZE (reg->op->args[1]);
+        arg_size = (arg_size > MOCK_MAX_VAL_SIZE) ? MOCK_MAX_VAL_SIZE : arg_size;
+        memcpy (reg->value, &args[1], arg_size);
+        _mock_reply (service, MOCK_REPLY_OK, NULL, 0);
+    }
+    else if (value_size > 0) {
+        _mock_reply (service, MOCK_REPLY_OK, reg->value, value_size);
+    }
+    else {
+        _mock_reply (service, MOCK_REPLY_OK, NULL, 0);
+    }
+}
+
+static void *_mock_service_run (void *arg)
+{
+    mock_service_t *service = (mock_service_t *) arg;
+
+    service->mlm_client = mlm_client_new ();
+    if (service->mlm_client == NULL ||
+            mlm_client_connect (service->mlm_client, service->cfg->broker_endp, 1000,
+                service->service) < 0) {
+        fprintf (stderr, "[halcs_mock]: Could not register %s\n", service->service);
+        mlm_client_destroy (&service->mlm_client);
+        return NULL;
+    }
+
+    zpoller_t *poller = zpoller_new (mlm_client_msgpipe (service->mlm_client), NULL);
+    while (!mock_stop && !zctx_interrupted) {
+        if (zpoller_wait (poller, MOCK_POLL_MS) == NULL) {
+            if (zpoller_terminated (poller)) {
+                break;
+            }
+            continue;
+        }
+
+        zmsg_t *msg = mlm_client_recv (service->mlm_client);
+        if (msg == NULL) {
+            break;
+        }
+        _mock_handle (service, msg);
+        zmsg_destroy (&msg);
+    }
+
+    zpoller_destroy (&poller);
+    mlm_client_destroy (&service->mlm_client);
+    return NULL;
+}
+
+/* Parse a list of numbers and ranges such as "0-3,7" */
+static int _parse_number_list (const char *str, uint32_t *list, uint32_t max)
+{
+    uint32_t num = 0;
+    const char *p = str;
+
+    while (*p != '\0') {
+        char *end;
+        unsigned long first = strtoul (p, &end, 10);
+        unsigned long last = first;
+        if (end == p) {
+            return -1;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            last = strtoul (p, &end, 10);
+            if (end == p || last < first) {
+                return -1;
+            }
+        }
+        for (unsigned long n = first; n <= last; n++) {
+            if (num == max) {
+                return -1;
+            }
+            list[num++] = n;
+        }
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return -1;
+        }
+    }
+    return num;
+}
+
+/* Sample layout of the boards, as the ACQ client library reports it */
+static void _mock_default_layout (mock_cfg_t *cfg)
+{
+    for (uint32_t chan = 0; chan < END_CHAN_ID; chan++) {
+        cfg->sample_size[chan] = (chan <= 1) ? 4*sizeof (int16_t) : 4*sizeof (int32_t);
+    }
+
+    acq_client_t *acq_client = acq_client_new (cfg->broker_endp, 0, NULL);
+    if (acq_client == NULL) {
+        return;
+    }
+    const acq_chan_t *acq_chan = acq_get_chan (acq_client);
+    for (uint32_t chan = 0; chan < END_CHAN_ID; chan++) {
+        cfg->sample_size[chan] = acq_chan[chan].sample_size;
+    }
+    acq_client_destroy (&acq_client);
+}
+
+static void print_usage (const char *program_name, FILE *stream, int exit_code)
+{
+    fprintf (stream, "Usage:  %s options\n", program_name);
+    fprintf (stream,
+            "  -h  --help                       Display this usage information.\n"
+            "  -v  --verbose                    Print every request\n"
+            "  -e  --endpoint <endpoint>        Broker endpoint to bind (default " MOCK_DFLT_BROKER ")\n"
+            "  -d  --board <list>               Boards to serve, e.g. 0-11 (default 0)\n"
+            "  -m  --bpm <list>                 BPMs of each board, e.g. 0,1 (default 0)\n"
+            "  --latency <us>                   Delay of every reply (default 0)\n"
+            "  --bandwidth <MB/s>               Reply bandwidth (default 0, unlimited)\n"
+            "  --acqtime <us>                   Time from acq_start until data is ready (default %d)\n"
+            "  --maxsamples <number>            Largest acquisition accepted (default %d)\n"
+            "  --samplesize <chan>:<8|16>       Sample size of a channel: 4 lanes of int16 or int32\n"
+            "                                     (default from the ACQ client library)\n"
+            "  --adcfreq <fraction>             ADC carrier over the sampling rate (default %g)\n"
+            "  --tunex <tune>                   Horizontal betatron tune (default %g)\n"
+            "  --tuney <tune>                   Vertical betatron tune (default %g)\n"
+            "  --posamp <nm>                    Betatron oscillation amplitude (default %g)\n",
+            MOCK_DFLT_ACQ_TIME_US, MOCK_DFLT_MAX_SAMPLES, MOCK_DFLT_ADC_FREQ, MOCK_DFLT_TUNE_X,
+            MOCK_DFLT_TUNE_Y, MOCK_DFLT_POS_AMP);
+    exit (exit_code);
+}
+
+enum {
+    latency = 1000,
+    bandwidth,
+    acqtime,
+    maxsamples,
+    samplesize,
+    adcfreq,
+    tunex,
+    tuney,
+    posamp
+};
+
+int main (int argc, char *argv [])
+{
+    mock_cfg_t cfg = {
+        .acq_time_us = MOCK_DFLT_ACQ_TIME_US,
+        .max_samples = MOCK_DFLT_MAX_SAMPLES,
+        .adc_freq = MOCK_DFLT_ADC_FREQ,
+        .tune_x = MOCK_DFLT_TUNE_X,
+        .tune_y = MOCK_DFLT_TUNE_Y,
+        .pos_amp = MOCK_DFLT_POS_AMP
+    };
+    const char *board_str = "0";
+    const char *bpm_str = "0";
+    uint32_t layout[END_CHAN_ID] = {0};
+    int ret = EXIT_SUCCESS;
+    int ch;
+
+    static struct option long_options[] = {
+        {"help",        no_argument,         NULL, 'h'},
+        {"verbose",     no_argument,         NULL, 'v'},
+        {"endpoint",    required_argument,   NULL, 'e'},
+        {"board",       required_argument,   NULL, 'd'},
+        {"bpm",         required_argument,   NULL, 'm'},
+        {"latency",     required_argument,   NULL, latency},
+        {"bandwidth",   required_argument,   NULL, bandwidth},
+        {"acqtime",     required_argument,   NULL, acqtime},
+        {"maxsamples",  required_argument,   NULL, maxsamples},
+        {"samplesize",  required_argument,   NULL, samplesize},
+        {"adcfreq",     required_argument,   NULL, adcfreq},
+        {"tunex",       required_argument,   NULL, tunex},
+        {"tuney",       required_argument,   NULL, tuney},
+        {"posamp",      required_argument,   NULL, posamp},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((ch = getopt_long (argc, argv, "hve:d:m:", long_options, NULL)) != -1) {
+        switch (ch) {
+            case 'v':
+                cfg.verbose = 1;
+                break;
+            case 'e':
+                cfg.broker_endp = strdup (optarg);
+                break;
+            case 'd':
+                board_str = optarg;
+                break;
+            case 'm':
+                bpm_str = optarg;
+                break;
+            case latency:
+                cfg.latency_us = strtoll (optarg, NULL, 10);
+                break;
+            case bandwidth:
+                cfg.bandwidth = strtod (optarg, NULL);
+                break;
+            case acqtime:
+                cfg.acq_time_us = strtoll (optarg, NULL, 10);
+                break;
+            case maxsamples:
+                cfg.max_samples = strtoull (optarg, NULL, 10);
+                break;
+            case samplesize: {
+                char *end;
+                unsigned long chan = strtoul (optarg, &end, 10);
+                unsigned long size = (*end == ':') ? strtoul (end + 1, NULL, 10) : 0;
+                if (chan >= END_CHAN_ID || (size != 8 && size != 16)) {
+                    fprintf (stderr, "%s: Invalid sample size '%s'\n", argv[0], optarg);
+                    print_usage (argv[0], stderr, EXIT_FAILURE);
+                }
+                layout[chan] = size;
+                break;
+            }
+            case adcfreq:
+                cfg.adc_freq = strtod (optarg, NULL);
+                break;
+            case tunex:
+                cfg.tune_x = strtod (optarg, NULL);
+                break;
+            case tuney:
+                cfg.tune_y = strtod (optarg, NULL);
+                break;
+            case posamp:
+                cfg.pos_amp = strtod (optarg, NULL);
+                break;
+            case 'h':
+                print_usage (argv[0], stdout, EXIT_SUCCESS);
+                break;
+            default:
+                print_usage (argv[0], stderr, EXIT_FAILURE);
+        }
+    }
+
+    int num_boards = _parse_number_list (board_str, cfg.board_list, MOCK_MAX_NUM_BOARDS);
+    int num_bpms = _parse_number_list (bpm_str, cfg.bpm_list, MOCK_MAX_NUM_BPMS);
+    if (num_boards <= 0 || num_bpms <= 0) {
+        fprintf (stderr, "%s: Invalid board or bpm list\n", argv[0]);
+        print_usage (argv[0], stderr, EXIT_FAILURE);
+    }
+    cfg.num_boards = num_boards;
+    cfg.num_bpms = num_bpms;
+
+    if (cfg.broker_endp == NULL) {
+        cfg.broker_endp = strdup (MOCK_DFLT_BROKER);
+    }
+
+    zactor_t *broker = zactor_new (mlm_server, "halcs_mock");
+    if (broker == NULL) {
+        fprintf (stderr, "[halcs_mock]: Could not start the broker\n");
+        return EXIT_FAILURE;
+    }
+    zstr_sendx (broker, "BIND", cfg.broker_endp, NULL);
+
+    _mock_default_layout (&cfg);
+    for (uint32_t chan = 0; chan < END_CHAN_ID; chan++) {
+        if (layout[chan] != 0) {
+            cfg.sample_size[chan] = layout[chan];
+        }
+    }
+
+    uint32_t num_services = cfg.num_boards*cfg.num_bpms*END_MOD;
+    mock_service_t *services = calloc (num_services, sizeof (mock_service_t));
+    if (services == NULL) {
+        fprintf (stderr, "[halcs_mock]: Error in memory allocation for the services\n");
+        zactor_destroy (&broker);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t num_started = 0;
+    for (uint32_t b = 0; b < cfg.num_boards; b++) {
+        for (uint32_t m = 0; m < cfg.num_bpms; m++) {
+            for (uint32_t module = 0; module < END_MOD; module++) {
+                mock_service_t *service = &services[num_started];
+                if (_mock_service_init (service, &cfg, module, cfg.board_list[b],
+                            cfg.bpm_list[m]) < 0 ||
+                        pthread_create (&service->thread, NULL, _mock_service_run, service) != 0) {
+                    fprintf (stderr, "[halcs_mock]: Could not start %s\n", service->service);
+                    _mock_service_destroy (service);
+                    mock_stop = 1;
+                    ret = EXIT_FAILURE;
+                    goto err_start;
+                }
+                num_started++;
+            }
+        }
+    }
+
+    printf ("[halcs_mock]: Serving %u services at %s\n", num_started, cfg.broker_endp);
+    fflush (stdout);
+    while (!zctx_interrupted) {
+        zclock_sleep (MOCK_POLL_MS);
+    }
+    mock_stop = 1;
+
+err_start:
+    for (uint32_t i = 0; i < num_started; i++) {
+        pthread_join (services[i].thread, NULL);
+        _mock_service_destroy (&services[i]);
+    }
+    free (services);
+    zactor_destroy (&broker);
+    free (cfg.broker_endp);
+    return ret;
+}
@@ -179,9 +179,36 @@ class BPMExperiment():
             else:
                 print(' '.join(command_argument_list))
 
-        # Timestamp the start of data acquisition
-        # FIXME: timestamp should ideally come together with data.
-        t = time()
+        # Throw away absolute path of data filename
+        data_filename_basename = os.path.basename(data_filename)
+
+        # Metadata file is placed in the same path and with the same filename as the data file, but with .metadata extension
+        output_metadata_filename = os.path.splitext(data_filename)[0] + '.metadata'
+
+        # Build the metadata template from the experiment metadata and what is known before the acquisition.
+        # The client completes it with the acquisition timestamps, parameters and data signature
+        config_base_metadata_lines = self.get_metadata_lines()
+
+        config_automatic_lines = [];
+        config_automatic_lines.append('data_original_filename = ' + data_filename_basename + '\n')
+        config_automatic_lines.append('dsp_data_rate_decimation_ratio = ' + rffe_switching_frequency_ratio + '\n')
+        if rffe_config:
+            config_automatic_lines.append('rffe_board_temperature = '+rffe_temp[0]+' C, '+rffe_temp[1]+' C, '+rffe_temp[2]+' C, '+rffe_temp[3]+'\n')
+
+        config_fromfile_lines = []
+        config_fromfile_lines.extend(config_base_metadata_lines)
+        config_fromfile_lines.extend(config_automatic_lines)
+
+        # Ensure file path exists
+        path = os.path.dirname(data_filename)
+        try:
+            os.makedirs(path)
+        except OSError as exception:
+            if not os.path.isdir(path):
+                raise
+
+        with open(output_metadata_filename, 'w') as f:
+            f.writelines(sorted(config_fromfile_lines))
 
         # Run acquisition
         # Get the result of data acquisition and write it to data file
@@ -194,63 +221,33 @@ class BPMExperiment():
         command_argument_list.extend(['--timeout', '15'])
         command_argument_list.extend(['--fullacq'])
         command_argument_list.extend(['--endpoint', self.broker_endpoint])
-
-        # Ensure file path exists
-        path = os.path.dirname(data_filename)
-        try:
-            os.makedirs(path)
-        except OSError as exception:
-            if not os.path.isdir(path):
-                raise
+        command_argument_list.extend(['--metadata', output_metadata_filename])
+        command_argument_list.extend(['--metadatafile', output_metadata_filename])
 
         with open(data_filename, 'w') as f:
             if not self.debug:
                 p = subprocess.call(command_argument_list, stdout=f)
             else:
-                f.writelines(['10 11 -9 80\n54 5 6 98\n']);
+                t = time()
+                text = '10 11 -9 80\n54 5 6 98\n'
+                f.write(text)
                 print(' '.join(command_argument_list))
 
-        # Compute data file signature
-        with open(data_filename, 'r') as f:
-            text = f.read()
-
-        if self.metadata['data_signature_method'].split()[0] == 'md5':
-            md = hashlib.md5()
-        elif self.metadata['data_signature_method'].split()[0] == 'sha-1':
-            md = hashlib.sha1()
-        elif self.metadata['data_signature_method'].split()[0] == 'sha-256':
-            md = hashlib.sha256()
-        md.update(text.encode(f.encoding))
-        filesignature = md.hexdigest()
-
-        # Format date and hour as an standard UTC timestamp (ISO 8601)
-        ns = int(floor((t * 1e9) % 1e9))
-        timestamp_start = '%s.%09dZ' % (strftime('%Y-%m-%dT%H:%M:%S', gmtime(t)), ns)
-
-        # Throw away absolute path of data filename
-        data_filename_basename = os.path.basename(data_filename)
-
-        # Build metadata file based on template metadata file and post-processed metadata
-        config_base_metadata_lines = self.get_metadata_lines()
-
-        config_automatic_lines = [];
-        config_automatic_lines.append('data_original_filename = ' + data_filename_basename + '\n')
-        config_automatic_lines.append('data_signature = ' + filesignature + '\n')
-        config_automatic_lines.append('dsp_data_rate_decimation_ratio = ' + rffe_switching_frequency_ratio + '\n')
-        config_automatic_lines.append('timestamp_start = ' + timestamp_start + '\n')
-        config_automatic_lines.append('data_file_format = ascii\n')
-        if rffe_config:
-            config_automatic_lines.append('rffe_board_temperature = '+rffe_temp[0]+' C, '+rffe_temp[1]+' C, '+rffe_temp[2]+' C, '+rffe_temp[3]+'\n')
-
-        config_fromfile_lines = []
-        config_fromfile_lines.extend(config_base_metadata_lines)
-        config_fromfile_lines.extend(config_automatic_lines)
-
-        # Metadata file is placed in the same path and with the same filename as the data file, but with .metadata extension
-        output_metadata_filename = os.path.splitext(data_filename)[0] + '.metadata'
-
-        with open(output_metadata_filename, 'w') as f:
-            f.writelines(sorted(config_fromfile_lines))
+        # Without the client, sign and timestamp the fake data here
+        if self.debug:
+            signature_method = self.metadata['data_signature_method'].split()[0]
+            hash_alg = {'md5': 'md5', 'sha-1': 'sha1', 'sha-256': 'sha256'}[signature_method]
+            filesignature = hashlib.new(hash_alg, text.encode()).hexdigest()
+
+            # Format date and hour as an standard UTC timestamp (ISO 8601)
+            ns = int(floor((t * 1e9) % 1e9))
+            timestamp_start = '%s.%09dZ' % (strftime('%Y-%m-%dT%H:%M:%S', gmtime(t)), ns)
+
+            config_fromfile_lines.append('data_signature = ' + filesignature + '\n')
+            config_fromfile_lines.append('timestamp_start = ' + timestamp_start + '\n')
+            config_fromfile_lines.append('data_file_format = ascii\n')
+            with open(output_metadata_filename, 'w') as f:
+                f.writelines(sorted(config_fromfile_lines))
 
 class BPMError(Exception):
     pass
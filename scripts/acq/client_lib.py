@@ -0,0 +1,95 @@
+# ctypes binding of libclient_lib.so (see client_lib.h): keeps a session
+# with one board/bpm open and transfers acquisitions straight into
+# caller buffers, e.g. NumPy arrays, instead of parsing the client output
+import ctypes
+import os
+
+class ClientLibError(Exception):
+    pass
+
+class ClientLib():
+
+    def __init__(self, broker_endpoint = 'ipc:///tmp/bpm', board = 0, bpm = 0, verbose = False,
+                 libpath = os.path.join(os.path.dirname(os.path.abspath(__file__)), '../../libclient_lib.so')):
+        self.lib = ctypes.CDLL(libpath)
+        self._declare()
+        self.session = self.lib.client_lib_open(broker_endpoint.encode(), board, bpm, int(verbose))
+        if not self.session:
+            raise ClientLibError('Could not connect to ' + broker_endpoint)
+
+    def _declare(self):
+        lib = self.lib
+        lib.client_lib_open.restype = ctypes.c_void_p
+        lib.client_lib_open.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_int]
+        lib.client_lib_close.argtypes = [ctypes.c_void_p]
+        lib.client_lib_err_str.restype = ctypes.c_char_p
+        lib.client_lib_err_str.argtypes = [ctypes.c_int]
+        lib.client_lib_get.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                       ctypes.c_void_p, ctypes.c_size_t]
+        lib.client_lib_set.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p,
+                                       ctypes.c_void_p, ctypes.c_size_t]
+        lib.client_lib_acq_start.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32,
+                                             ctypes.c_uint32, ctypes.c_uint32]
+        lib.client_lib_acq_wait.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        lib.client_lib_acq_curve_size.restype = ctypes.c_uint64
+        lib.client_lib_acq_curve_size.argtypes = [ctypes.c_void_p]
+        lib.client_lib_acq_fetch.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t,
+                                             ctypes.POINTER(ctypes.c_uint64)]
+
+    def _check(self, err):
+        if err != 0:
+            raise ClientLibError(self.lib.client_lib_err_str(err).decode())
+
+    def close(self):
+        if self.session:
+            self.lib.client_lib_close(self.session)
+            self.session = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    # Functions are given by module (e.g. 'DSP') and HALCS function name.
+    # ctype is the type of the value: c_uint16, c_uint32, c_uint64 or c_double
+    def get(self, module, name, ctype = ctypes.c_uint32):
+        value = ctype()
+        self._check(self.lib.client_lib_get(self.session, module.encode(), name.encode(),
+                                            ctypes.byref(value), ctypes.sizeof(value)))
+        return value.value
+
+    def set(self, module, name, value, ctype = ctypes.c_uint32):
+        value = ctype(value)
+        self._check(self.lib.client_lib_set(self.session, module.encode(), name.encode(),
+                                            ctypes.byref(value), ctypes.sizeof(value)))
+
+    def acq_start(self, chan, samples_pre, samples_post = 0, num_shots = 1):
+        self._check(self.lib.client_lib_acq_start(self.session, chan, samples_pre, samples_post, num_shots))
+
+    # timeout in ms, -1 to wait forever
+    def acq_wait(self, timeout = -1):
+        self._check(self.lib.client_lib_acq_wait(self.session, timeout))
+
+    def acq_curve_size(self):
+        return self.lib.client_lib_acq_curve_size(self.session)
+
+    # Transfer the curve into buf, any writable buffer (bytearray, NumPy
+    # array...) of at least acq_curve_size() bytes. Returns the bytes read
+    def acq_fetch_into(self, buf):
+        c_buf = (ctypes.c_char * len(memoryview(buf).cast('B'))).from_buffer(buf)
+        bytes_read = ctypes.c_uint64()
+        self._check(self.lib.client_lib_acq_fetch(self.session, c_buf, ctypes.sizeof(c_buf),
+                                                  ctypes.byref(bytes_read)))
+        return bytes_read.value
+
+    # Full acquisition into a new NumPy array of one row per sample and one
+    # column per lane: int16 for the ADC channels (0 and 1), int32 otherwise
+    def acquire(self, chan, samples_pre, samples_post = 0, num_shots = 1, timeout = -1):
+        import numpy
+        self.acq_start(chan, samples_pre, samples_post, num_shots)
+        self.acq_wait(timeout)
+        dtype = numpy.int16 if chan in (0, 1) else numpy.int32
+        data = numpy.empty(self.acq_curve_size() // numpy.dtype(dtype).itemsize, dtype = dtype)
+        bytes_read = self.acq_fetch_into(data)
+        return data[:bytes_read // data.itemsize].reshape(-1, 4)